@@ -16,809 +16,6293 @@
 #include <iomanip>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <bitset>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <map>
+#include <cstdio>
+#include <unordered_map>
+#include <queue>
+#include <string_view>
+#include <charconv>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cassert>
+#if __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#endif
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/random.h>
+#include <poll.h>
+#else
+#include <random>
+#endif
 using namespace std;
 
 /*
- *This struct stores the text in every phrase, the minimum guesses
- * needed, and whether or not the phrase has been used.
- * PASSED, DON'T TOUCH
+ *This enum holds what happened with a single guess. WON and LOST are
+ *returned for the guess that finished the game, and for any guess after.
  */
-struct Phrase
+enum GuessResult {HIT, MISS, REPEAT, INVALID_GUESS, WON, LOST};
+
+/*
+ *This enum is used to hold the difficulty levels to choose from
+ */
+enum DifficultyLevel {EASY, MEDIUM, HARD, INVALID_DIFFICULTY};
+
+const unsigned int MAX_MISSES = 5; //Wrong guesses until the game is lost
+
+//Moves the cursor to the top left and clears the terminal.
+constexpr string_view CLEAR_SCREEN = "\x1b[H\x1b[2J";
+
+//The gallows after each number of misses, built into the program.
+constexpr string_view GALLOWS_FRAMES[MAX_MISSES + 1] =
+{
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |       \n"
+	"   |       \n"
+	"   |       \n"
+	"   |       \n"
+	"  =============\n\n",
+
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |    O  \n"
+	"   |    |  \n"
+	"   |       \n"
+	"   |       \n"
+	"  =============\n\n",
+
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |    O  \n"
+	"   |   /|  \n"
+	"   |       \n"
+	"   |       \n"
+	"  =============\n\n",
+
+	// The '\\' will translate as \, because it is a special char
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |    O   \n"
+	"   |   /|\\ \n"
+	"   |        \n"
+	"   |        \n"
+	"  =============\n\n",
+
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |    O   \n"
+	"   |   /|\\ \n"
+	"   |     \\ \n"
+	"   |        \n"
+	"  =============\n\n",
+
+	"   +----+     \n"
+	"   |    |     \n"
+	"   |    O    \n"
+	"   |   /|\\  \n"
+	"   |   / \\  \n"
+	"   |You're Dead\n"
+	"  =============\n\n"
+};
+
+/*
+ *This struct holds what the game needs to know about every byte: the
+ *bit for the letter it is, the same byte when case doesn't matter, and
+ *what is shown while it is hidden. It is the one place characters are
+ *sorted out. Only letters are ever blanks, anything that can't be
+ *guessed is always shown as it is.
+ */
+struct CharTable
+{
+	unsigned int bit[256]; //Bit n for 'a' + n or 'A' + n, 0 for anything else
+	char lower[256]; //The lowercase letter, or the byte itself
+	char hidden[256]; //'_' for a letter, the byte itself for anything else
+};
+
+//Every byte's entry, worked out when the program is compiled.
+constexpr CharTable CHAR_TABLE = []
+{
+	CharTable table = {};
+	for (int ch = 0; ch < 256; ch++)
+	{
+		table.lower[ch] = static_cast<char>(ch >= 'A' && ch <= 'Z' ? ch + 32 : ch);
+		table.bit[ch] = table.lower[ch] >= 'a' && table.lower[ch] <= 'z' ? 
+			1u << (table.lower[ch] - 'a') : 0;
+		table.hidden[ch] = table.bit[ch] != 0 ? '_' : static_cast<char>(ch);
+	}
+	return table;
+}();
+
+//The plain letters for U+00C0 to U+017F, two characters for each,
+//padded with a space. Two spaces means it isn't a letter.
+constexpr char LATIN_FOLDS[] =
+	"A A A A A A AEC E E E E I I I I " //U+00C0
+	"D N O O O O O   O U U U U Y THss" //U+00D0
+	"a a a a a a aec e e e e i i i i " //U+00E0
+	"d n o o o o o   o u u u u y thy " //U+00F0
+	"A a A a A a C c C c C c C c D d " //U+0100
+	"D d E e E e E e E e E e G g G g " //U+0110
+	"G g G g H h H h I i I i I i I i " //U+0120
+	"I i IJijJ j K k k L l L l L l L " //U+0130
+	"l L l N n N n N n n N n O o O o " //U+0140
+	"O o OEoeR r R r R r S s S s S s " //U+0150
+	"S s T t T t T t U u U u U u U u " //U+0160
+	"U u U u W w Y y Y Z z Z z Z z s "; //U+0170
+
+/*
+ *This struct holds how one set of rules sees every byte: the symbol it
+ *is when it can be guessed, with a bit for it, and the byte a guess of
+ *it is stored as.
+ */
+struct SymbolTable
+{
+	int8_t symbol[256]; //Symbols count up from 0, -1 if the byte is always shown
+	uint64_t bit[256]; //1 shifted by the symbol, 0 if it isn't one
+	char guessed[256]; //The byte itself, or lowercase when case doesn't matter
+};
+
+/*
+ *Builds the symbol table for a set of rules when the program is
+ *compiled, with the letters taken from CHAR_TABLE. Lowercase letters are
+ *always symbols 0 to 25, so the bits are the same as letterBit's, then
+ *uppercase letters if case matters, then the digits if they are allowed.
+ */
+constexpr SymbolTable buildSymbolTable(const bool DIGITS, const bool CASE_SENSITIVE)
+{
+	SymbolTable table = {};
+	for (int ch = 0; ch < 256; ch++)
+	{
+		const unsigned int LETTER = CHAR_TABLE.bit[ch];
+		int symbol = -1;
+		if (LETTER != 0)
+			symbol = (CASE_SENSITIVE && CHAR_TABLE.lower[ch] != ch ? 26 : 0) + 
+				__builtin_ctz(LETTER);
+		else if (DIGITS && ch >= '0' && ch <= '9')
+			symbol = (CASE_SENSITIVE ? 52 : 26) + ch - '0';
+		table.symbol[ch] = static_cast<int8_t>(symbol);
+		table.bit[ch] = symbol < 0 ? 0 : 1ull << symbol;
+		table.guessed[ch] = static_cast<char>(!CASE_SENSITIVE && ch >= 'A' && ch <= 'Z' ?
+			ch + 32 : ch);
+	}
+	return table;
+}
+
+/*
+ *This struct template holds the rules a game is played by. They are
+ *fixed when the program is compiled, so every check against them in a
+ *game folds down to a constant. MISSES is the wrong guesses until the
+ *game is lost, DIGITS lets '0' to '9' be guessed, CASE_SENSITIVE makes
+ *'A' and 'a' different guesses, and TIERS is the number of difficulty
+ *levels the phrases are split into.
+ */
+template <unsigned int MISSES, bool DIGITS, bool CASE_SENSITIVE, int TIERS>
+struct Rules
 {
-	string text; //Stores the text of the phrase
-	unsigned int guessesRequired; //contains the minimum guesses
-	bool isUsed = false; //True means the phrase has been used.
+	static_assert(MISSES >= 1 && TIERS >= 1, "A game needs a miss and a level");
+	static constexpr unsigned int MAX_MISSES = MISSES; //Wrong guesses until the game is lost
+	static constexpr int SYMBOLS = (CASE_SENSITIVE ? 52 : 26) + (DIGITS ? 10 : 0); //Different guesses
+	static constexpr int LEVELS = TIERS; //Difficulty levels
+	static constexpr SymbolTable TABLE = buildSymbolTable(DIGITS, CASE_SENSITIVE);
+	using Mask = conditional_t<SYMBOLS <= 32, uint32_t, uint64_t>; //A bit for every symbol
 };
 
+//The rules the regular game, the solver, and the server play by.
+using StandardRules = Rules<MAX_MISSES, false, false, INVALID_DIFFICULTY>;
+
 /*
  *This struct holds the right, wrong, and total guesses and the number 
  *of guesses of the user while playing the game.
  */
-struct Guesses
+template <class R>
+struct BasicGuesses
 {
 	unsigned int numOfGuesses;
 	string charGuesses;
+	typename R::Mask letterMask; //Bit n is set if symbol n was guessed
 };
 
 /*
- *This enum is used to hold the difficulty levels to choose from
+ *This struct holds the phrase with blanks for a single game, in the same
+ *form as phraseWithBlanks, along with where every symbol appears in it.
+ *A correct guess only patches the positions of that symbol.
  */
-enum DifficultyLevel {EASY, MEDIUM, HARD, INVALID_DIFFICULTY};
+template <class R>
+struct BasicReveal
+{
+	string blankPhrase; //The phrase with blanks as shown to the user
+	unsigned int letterStart[R::SYMBOLS + 1]; //Symbol n is at positions[letterStart[n]]
+	vector<unsigned int> positions; //Indexes into blankPhrase, by symbol
+	string letters; //The phrase's character at each of the positions
+	unsigned int lettersLeft; //Unique symbols that are still blanks
+};
 
-/**
- * Displays the gallows. As the miss count increases, more of the person is
- * displayed hanging from the gallows. Called in RunGame
+/*
+ *This struct holds everything about a single game in progress, so a
+ *game can be played without the console.
  */
-void drawGallows(int missCount);
+template <class R>
+struct BasicGame
+{
+	int phraseIndex; //Index of the phrase being guessed
+	typename R::Mask phraseMask; //Symbols in the phrase
+	BasicGuesses<R> guess[3]; //Index 0 is correct, index 1 is wrong, index 2 holds all
+	BasicReveal<R> reveal; //The phrase with blanks
+	uint64_t seed; //State of the random stream the phrase was drawn from, 0 if none
+};
+
+using Guesses = BasicGuesses<StandardRules>;
+using RevealState = BasicReveal<StandardRules>;
+using Game = BasicGame<StandardRules>;
 
 /*
- *Reads in a file where each line is the text of a phrase. 
- *Initializes an array of Phrases. Returns the number of
- *phrases.  Called in main.
+ *This struct holds a game by the standard rules in 16 bytes with nothing
+ *on the heap, so it copies like an int and millions of them fit in the
+ *cache. Every check is done on the masks, and the blank phrase is drawn
+ *from the phrase and correctMask only when it is shown. The order of the
+ *guesses is kept apart from it in a GuessHistory where it is needed.
  */
-int loadPhrasesFromFile(const string FILE_NAME, Phrase phraseArray[],
-    const int MAX_LENGTH);
+struct CompactGame
+{
+	uint32_t phraseIndex; //Index of the phrase being guessed
+	uint32_t guessedMask; //Bit n is set if letter 'a' + n was guessed
+	uint32_t correctMask; //The guessed letters that are in the phrase
+	uint8_t misses; //Wrong guesses
+	uint8_t guesses; //Letters guessed
+	uint16_t unused; //Keeps the size a multiple of 4
+};
+
+static_assert(sizeof(CompactGame) <= 16 && is_trivially_copyable_v<CompactGame>,
+	"A compact game has to stay 16 plain bytes");
 
 /*
- *The purpose of this function is to only allow unique characters from
- *A-Z to count as case insensitive unique characters. This will filter
- *out punctuation and spaces, and change uppercase to lowercase so that
- *all cases will be considered the same.  UniqueLetterCount will still
- *determine the uniqueness of the character.
- *Called in uniqueLetterCount.
+ *This struct holds the order a compact game's letters were guessed in,
+ *each as the letter's number at 5 bits each, first in the lowest bits,
+ *the same way the replay log packs them. A game guesses each of the 26
+ *letters at most once, so 130 bits is always enough.
  */
-bool maybeUnique(const string UNIQ_CHARS, char& ch);
+struct GuessHistory
+{
+	uint64_t bits[3]; //Guess n is bits n * 5 to n * 5 + 4
+};
+
+//The variants that can be played on the console with --rules.
+using SevenMissRules = Rules<7, false, false, INVALID_DIFFICULTY>;
+using DigitRules = Rules<MAX_MISSES, true, false, INVALID_DIFFICULTY>;
+using ExactCaseRules = Rules<MAX_MISSES, false, true, INVALID_DIFFICULTY>;
+using FiveLevelRules = Rules<MAX_MISSES, false, false, 5>;
 
 /*
- *This function takes a single phrase and checks the number of 
- *unique characters in that phrase, returning the amount.
- *Called in main.
+ *This struct is a seedable random number generator. Every game in a
+ *simulation gets its own stream from the seed and the game number, so
+ *the results don't depend on which thread played it.
  */
-int uniqueLetterCount(const string SINGLE_PHRASE);
+struct Random
+{
+	uint64_t state; //Moves forward by a fixed step for every number
+};
 
 /*
- *Outputs the phrases after the guesses and use are known
- *Used for testing, so not called.
+ *This struct holds one simulation worker's range of games that haven't
+ *been played yet, packed as the first game in the high half and one
+ *past the last game in the low half so it can be changed atomically.
+ *Workers take games from the front of their own range and steal the
+ *back half of another worker's range once theirs runs out.
  */
-void printPhrases(const Phrase phraseArray[], const int PHRASE_NUM);
+struct alignas(64) WorkRange
+{
+	atomic<uint64_t> range;
+};
 
 /*
- *This function sorts the phrases based on the number of guesses that are
- *required to complete the phrase. Called in main.
+ *This struct adds up the games a simulation worker played.
  */
-void sortPhrases(Phrase phraseArray[], 
-	const int PHRASE_NUM);
+struct SimulationTotals
+{
+	long long games = 0; //Games played
+	long long wins = 0; //Games won
+	long long guesses = 0; //Letters guessed
+	long long misses = 0; //Letters that weren't in the phrase
+	uint64_t checksum = 0; //Sum of a hash of every game's result
+};
 
 /*
- *The purpose of this function is to swap the components of phrase and guess array.
- *Called in sortPhrases.
+ *This struct holds one line of the benchmark results, the time a single
+ *call took on average for one function and corpus.
  */
-void swapPhrases(const int INDEX, const int SMALL_INDEX, Phrase phraseArray[]);
+struct BenchResult
+{
+	string name; //Function that was timed
+	long long phrases; //Phrases in the synthetic corpus
+	string lengths; //Which phrase lengths the corpus used
+	double nsPerOp; //Average nanoseconds per call
+	long long ops; //Calls that were timed
+};
+
+struct Corpus;
 
 /*
- *The purpose of this function is to display the current phrase 
- *with blanks including the correctly guessed character.
- *Function called in runGame
+ *This struct holds one player connected to the server: the game they
+ *are playing in the session table, and what has been read from and is
+ *waiting to be written to the socket.
  */
-string phraseWithBlanks(const string CURRENT_PHRASE, const string CORRECT_GUESSES);
+struct ServerSession
+{
+	uint64_t gameId = 0; //The player's game in the SessionTable, 0 for none
+	string in; //Bytes read that haven't been answered yet
+	string out; //Replies that haven't been sent yet
+	uint32_t events = 0; //What epoll is waiting for on the socket
+};
 
 /*
- *The purpose of this function is to support phraseWithBlanks to find out
- *what value should be passed to the string that holds the blanks.
- *It can only be used when Correct guesses is longer than 0.
- *Called in phraseWithBlanks.
+ *This struct holds one connection of the load generator, playing games
+ *against the server one request at a time.
  */
-char withGuesses(char currentVal, char guessVal);
+struct LoadSession
+{
+	int fd; //The connection to the server, -1 once it is closed
+	int gamesLeft; //Games still to play after this one
+	size_t nextLetter; //Position in the guess order for the next guess
+	string in; //Bytes read that aren't a full line yet
+	bool newGame; //True if the next request starts a game
+	chrono::steady_clock::time_point sent; //When the last request went out
+};
 
+#if __cpp_impl_coroutine >= 201902L
 /*
- *The purpose of this function is to support phraseWithBlanks to find out
- *what value should be passed to the string that holds the blanks.
- *It can only be used when Correct guesses is 0 length.
- *Called in phraseWithBlanks.
+ *This struct is a game running as a coroutine. It is suspended while it
+ *waits for a guess, so one thread can keep any number of games going at
+ *once and resume whichever one gets its next guess. The game lives in
+ *the coroutine's frame, which is reused from a pool once the game ends.
+ *A task owns its coroutine and destroys it along with itself, so it can
+ *be moved but not copied.
  */
-char withoutGuesses(char currentVal);
+struct GameTask
+{
+	struct promise_type
+	{
+		Game game; //The game being played
+		char guess = 0; //The guess the game was resumed with
+		GuessResult result = HIT; //What the last guess did
+
+		GameTask get_return_object();
+		suspend_never initial_suspend() noexcept { return {}; }
+		suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { terminate(); }
+		static void* operator new(size_t size);
+		static void operator delete(void* frame, size_t size);
+	};
+
+	/*
+	 *Awaited by the game to get its promise without suspending.
+	 */
+	struct GetPromise
+	{
+		promise_type* promise = nullptr;
+		bool await_ready() { return false; }
+		bool await_suspend(coroutine_handle<promise_type> handle)
+		{ promise = &handle.promise(); return false; }
+		promise_type& await_resume() { return *promise; }
+	};
+
+	/*
+	 *Awaited by the game to suspend until the next guess comes in.
+	 */
+	struct NextGuess
+	{
+		promise_type* promise = nullptr;
+		bool await_ready() { return false; }
+		void await_suspend(coroutine_handle<promise_type> handle)
+		{ promise = &handle.promise(); }
+		char await_resume() { return promise->guess; }
+	};
+
+	GameTask() = default;
+	explicit GameTask(const coroutine_handle<promise_type> HANDLE) : handle(HANDLE) {}
+	GameTask(GameTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+	GameTask& operator=(GameTask&& other) noexcept;
+	GameTask(const GameTask&) = delete;
+	GameTask& operator=(const GameTask&) = delete;
+	~GameTask();
+
+	coroutine_handle<promise_type> handle; //The suspended game, null once moved from
+};
 
 /*
- *The purpose of this function is to get the difficulty level from the user.
- *Function called in main.
+ *This struct holds the frames of finished games one thread keeps to
+ *reuse. They are all the same size, and are freed when the thread ends.
  */
-DifficultyLevel getDifficultyLevel();
+struct FramePool
+{
+	vector<void*> frames; //Frames nothing is using
+	size_t frameSize = 0; //Bytes in each of them, 0 until the first is made
+	~FramePool();
+};
+#endif
 
 /*
- *The purpose of this function is to declare values for the enumeration type
- *that correspond to a string.  This function is called in main.
-*/
-string convertDifficulty(DifficultyLevel diff);
+ *This enum holds the ways the solver can pick its next letter.
+ *FREQUENCY guesses the letters that are in the most phrases first.
+ *ELIMINATION narrows the phrases down to those that still fit the
+ *pattern and guesses the letter that is in the most of them.
+ */
+enum SolverStrategy {FREQUENCY, ELIMINATION};
 
 /*
- *This function is to get the index of the next phrase to be used.
- * It gets this based off the difficulty that the user chooses, and
- * whether or not that phrase has been used.  Called in main.
+ *This struct holds what the solver knows about the phrases before any
+ *game starts: the letters in order of how many phrases have them, and
+ *the phrases grouped by length.
  */
-int randomPhraseIndex(int diff, const Phrase PHRASE_ARRAY[], int phraseNum);
+struct Solver
+{
+	SolverStrategy strategy; //How the next letter is picked
+	const Corpus* corpus; //The phrases the solver can eliminate from
+	string letterOrder; //Letters from in the most phrases to the fewest
+	vector<int> lengthStart; //Phrases of length n are byLength[lengthStart[n]] on
+	vector<int> byLength; //Phrase indexes sorted by length
+	chrono::nanoseconds budget; //Most time a single guess can take
+};
 
 /*
- *Once main has assembled and sorted all information needed to run
- *the game, this function is called to run a single Hangman game.
- * Called in main.
- */ 
-void runGame(Phrase singlePhrase);
+ *This struct holds the solver's state for a single game, the phrases
+ *that may still be the answer. It can hold extra phrases if filtering
+ *ran out of time, but never misses the answer.
+ */
+struct SolverGame
+{
+	vector<int> candidates; //Phrases that may still be the answer
+};
 
 /*
- *This function checks the user's character guess and determines
- *whether it is valid, previously guessed, right, or wrong.
- *Called in runGame.
+ *This struct orders the phrases from easiest to hardest without moving
+ *them. order holds phrase indexes sorted by the misses the reference
+ *solver made on them and then by the guesses they require, or only by
+ *the guesses when there are no scores. Each difficulty level is a range
+ *of order.
  */
-void checkGuess(const char USER_GUESS, const string SINGLE_PHRASE, 
-	Guesses guess[]);
+struct DifficultyIndex
+{
+	vector<int> order; //Phrase indexes from easiest to hardest
+	int bucketStart[28]; //Phrases with n misses, or needing n guesses without scores, start at order[bucketStart[n]]
+	int tierStart[INVALID_DIFFICULTY + 1]; //Level n is order[tierStart[n]] up to order[tierStart[n + 1]]
+};
 
-/*Display Result shows the results of the win or loss.
- *Called in runGame.
+/*
+ *This struct holds the phrases that haven't been used yet for every
+ *difficulty level. With three levels each is the same range of slots as
+ *in the DifficultyIndex, any other number splits the index evenly. The
+ *unused phrases in a level come first. Drawing a phrase swaps
+ *it behind the unused ones, so a phrase is used exactly when its slot
+ *is past its level's unused ones. Once a level runs out, its unused
+ *count goes back to the whole level and its epoch goes up, which makes
+ *every phrase in it unused again without touching any of them.
  */
-void displayResult(int wrongGuesses, 
-	const string PHRASE, const string BLANK_PHRASE);
+template <int LEVELS>
+struct BasicPhrasePool
+{
+	vector<int> slots; //Phrase indexes, grouped by difficulty level
+	vector<int> slotOf; //Where each phrase is in slots
+	int tierStart[LEVELS + 1]; //Same ranges as DifficultyIndex with three levels
+	int unusedCount[LEVELS]; //Unused phrases left in each level
+	int epoch[LEVELS]; //Passes through each level started so far
+};
+
+using PhrasePool = BasicPhrasePool<INVALID_DIFFICULTY>;
 
 /*
- *Play again asks the user if they want to play again and
- * returns true if so, false if not.  Called in main.
+ *This struct stores every phrase as parallel arrays: the text, the
+ *letters in it, and the minimum guesses needed. A scan only pulls in
+ *the arrays it reads. The arrays point
+ *into the arenas when the phrases came from a text file, or into
+ *fileData, the compiled corpus file. That is why a Corpus is never
+ *copied.
  */
-bool playAgain();
+struct Corpus
+{
+	int phraseNum = 0; //Number of phrases
+	const char* text = nullptr; //The text of every phrase, back to back
+	const uint64_t* starts = nullptr; //Phrase n is text[starts[n]] up to text[starts[n + 1]]
+	const uint32_t* masks = nullptr; //Bit n is set if letter 'a' + n is in the phrase
+	const uint8_t* counts = nullptr; //The minimum guesses for each phrase
+	DifficultyIndex index; //The phrases sorted by guesses required
 
-/*
- *This function makes Uppercase characters into lowercase.
- * Called in maybe unique and run Game
- */ 
-char toLower(char uGuess);
+	vector<char> textArena; //Holds the text loaded from a text file
+	vector<uint64_t> startArena; //Holds the starts when they aren't mapped
+	vector<uint32_t> maskArena; //Holds the masks when they aren't mapped
+	vector<uint8_t> countArena; //Holds the counts when they aren't mapped
+	const char* fileData = nullptr; //The compiled corpus, mapped or read in
+	size_t fileSize = 0; //Bytes in fileData
+	bool mapped = false; //True if fileData has to be unmapped
 
-bool checkVictory(string guessedPhrase);
+	Corpus() = default;
+	Corpus(const Corpus&) = delete;
+	Corpus& operator=(const Corpus&) = delete;
+	~Corpus();
+};
 
-int main()
+/*
+ *This struct holds the corpus the server deals new games from. A reload
+ *builds a whole new corpus on its own thread and swaps it in, so games
+ *that already started keep the one they started with. Event loops only
+ *load the pointer again when the version has changed.
+ */
+struct CorpusFeed
 {
-    const string FILE_NAME = "phrases.txt"; //Name of file to load from
-    const int MAX_PHRASES = 100; //Max number of phrases array will take
+	shared_ptr<const Corpus> current; //Only used with atomic_load and atomic_store
+	atomic<uint64_t> version{0}; //Goes up with every reload
+};
 
-	//holds the number of phrases the user plays
-	int phrasesAsked = 0;
+const int SESSION_SHARDS = 256; //Shards in the session table, a power of two
+const size_t SESSION_LIMIT = 1 << 20; //Games the session table holds at most
+const chrono::seconds SESSION_TTL(600); //Games untouched this long are dropped
+const chrono::seconds SESSION_SWEEP(1); //How often each event loop drops old games
 
-	//This enum is the difficulty level.
-	DifficultyLevel difficulty;	
+/*
+ *This struct holds a game in the session table with the corpus it
+ *started with and when a request last used it.
+ */
+struct StoredGame
+{
+	CompactGame game; //The game in progress
+	GuessHistory history; //The order of the game's guesses, for the replay log
+	uint64_t seed; //State of the random stream the phrase was drawn from
+	shared_ptr<const Corpus> corpus; //Keeps the phrases alive through a reload
+	chrono::steady_clock::time_point touched; //Last request for this game
+};
 
-	//Holds the phrases, guesses required, and uses.
-    Phrase phraseArray[MAX_PHRASES];
+/*
+ *This struct holds one shard of the session table. The low bits of a
+ *game's id pick its shard, so requests for different games rarely wait
+ *on the same lock. Each shard has room for its share of SESSION_LIMIT
+ *from the start and never grows past it.
+ */
+struct alignas(64) SessionShard
+{
+	mutex lock; //Guards games
+	unordered_map<uint64_t, StoredGame> games; //Games in progress, by id
+};
 
-	//holds the index value for the next phrase to be played
-	int nextPhrase = -1;
+/*
+ *This struct holds every game in progress on the server, so a game
+ *isn't tied to the connection or the thread that started it.
+ */
+struct SessionTable
+{
+	vector<SessionShard> shards; //SESSION_SHARDS of them
+};
 
-	//initializes phraseArray to the number of phrases, max 100
-    //Holds the actual length of the phraseArray in MAX_USED_INDEX
-	//Initialize the array with the number of unique characters/min guesses.
-    const int MAX_USED_INDEX = loadPhrasesFromFile(FILE_NAME, phraseArray,
-    MAX_PHRASES);
+const int TEXT_CHECK_LIMIT = 64; //Matches left when queryPattern reads their text
+const int LATENCY_BUCKETS = 40; //Bucket n holds times from 2^n up to 2^(n+1) ns
+const uint32_t LATENCY_SAMPLE = 64; //Guesses per thread for each one timed
 
-	//Get all of the guesses required for the phrases.
-	for (int index = 0; index < MAX_USED_INDEX; index++)
-	{
-		phraseArray[index].guessesRequired = 	
-			uniqueLetterCount(phraseArray[index].text);
-	}
+/*
+ *This struct finds the phrases that fit a phrase with blanks without
+ *reading their text. Phrases are ranked by their shape, which is the
+ *phrase with every letter as a blank, so phrases with the same length
+ *and words are next to each other. Each bitset has one bit per rank,
+ *and a query only looks at the words that hold its shape's ranks.
+ *The letters at each position are kept as runs of the bitset's words
+ *that aren't zero. Once only a few phrases are left they are checked
+ *against their text instead.
+ */
+struct PatternIndex
+{
+	int phraseNum = 0; //Phrases indexed, 0 until it is built
+	const Corpus* corpus = nullptr; //For checking the last few matches by text
+	vector<int> byShape; //Phrase indexes in rank order
+	vector<uint64_t> shapeKeys; //Every shape's hash, sorted
+	vector<int> shapeStart; //Shape n is ranks shapeStart[n] up to shapeStart[n + 1]
+	size_t words = 0; //Words in each bitset
+	vector<uint64_t> letterBits; //Letter n is words [n * words, (n + 1) * words)
+	vector<uint32_t> cellStart; //Letter l at position i is run i * 26 + l
+	vector<uint32_t> cellWord; //Which word of the bitset each run entry is
+	vector<uint64_t> cellBits; //The bits of that word
+};
 
-	//Sort the phrases based on their guesses required.
-	sortPhrases(phraseArray, MAX_USED_INDEX);
+/*
+ *This struct holds the phrases that fit a query, as the bits for the
+ *ranks from word firstWord on.
+ */
+struct PatternMatches
+{
+	size_t firstWord = 0; //Word of the first bit in bits
+	vector<uint64_t> bits; //Bit n is rank firstWord * 64 + n
+	int count = 0; //Bits set
+};
 
-	//Seed the random number generator using the current time.
-	srand(static_cast<unsigned int>(time(nullptr)));
+/*
+ *This enum names the steps whose times telemetry adds up.
+ */
+enum TimedStep {LOAD_TEXT, LOAD_COMPILED, SORT_PHRASES, TIMED_STEPS};
 
-	//Find the difficulty the user wants to play at.
-	difficulty = getDifficultyLevel();
+/*
+ *This struct holds one thread's telemetry counters. Only its own thread
+ *adds to them, so an add is a plain load and store, and a report can
+ *read them at any time. Shards are linked together and kept until the
+ *program ends so threads that have finished still count.
+ */
+struct alignas(64) TelemetryShard
+{
+	atomic<uint64_t> results[LOST + 1] = {}; //Guesses by their GuessResult
+	atomic<uint64_t> guessLatency[LATENCY_BUCKETS] = {}; //Sampled checkGuess times
+	atomic<uint64_t> turnLatency[LATENCY_BUCKETS] = {}; //User think time in runGame
+	uint32_t untilSample = 0; //Guesses until the next timed one
+	TelemetryShard* next = nullptr; //The shard made before this one
+};
 
-	do
-	{
-		//Find the next phrase based on the difficulty
-		nextPhrase = randomPhraseIndex(static_cast<int>(difficulty), 
-			phraseArray, MAX_USED_INDEX);
+/*
+ *This struct holds the telemetry for the whole program. Nothing is
+ *counted unless the HANGMAN_TELEMETRY environment variable names a file
+ *for the report. The per-phrase counts are shared by every thread and
+ *added to atomically, since two threads rarely finish the same phrase
+ *at once.
+ */
+struct Telemetry
+{
+	bool enabled = false;
+	string fileName; //Where the report is written
+	atomic<TelemetryShard*> shards{nullptr}; //The newest thread's shard
+	const Corpus* corpus = nullptr; //The phrases the per-phrase counts are for
+	vector<atomic<uint32_t>> plays; //Games with at least one guess, by phrase
+	vector<atomic<uint32_t>> wins; //Games won, by phrase
+	vector<atomic<uint32_t>> misses; //Wrong guesses in finished games, by phrase
+	vector<uint8_t> letters; //Unique letters in each phrase
+	atomic<uint64_t> stepNanos[TIMED_STEPS] = {}; //Time spent in each step
+	atomic<uint64_t> stepCalls[TIMED_STEPS] = {}; //Times each step ran
+};
 
-		//Show the user their current hangman, and show the phrase with blanks.
-		//Then, ask them for their guesses, and re-display based on that guess.
-		runGame(phraseArray[nextPhrase]);
+/*
+ *This struct is the start of a compiled corpus file. The sections after
+ *it each start on a multiple of 8 bytes: the text of every phrase back
+ *to back, where each phrase starts in the text with one more for the
+ *end of the last, the letter masks, the guesses required, and the
+ *phrases in difficulty order. Numbers are stored the way the
+ *machine that compiled the file stores them.
+ */
+struct CorpusHeader
+{
+	char magic[8]; //Always CORPUS_MAGIC
+	uint32_t version; //CORPUS_VERSION when the file was compiled
+	uint32_t phraseNum; //Number of phrases
+	uint64_t textOffset; //Where the text starts
+	uint64_t textBytes; //Length of the text
+	uint64_t startsOffset; //phraseNum + 1 uint64_t starts in the text
+	uint64_t masksOffset; //phraseNum uint32_t letter masks
+	uint64_t countsOffset; //phraseNum uint8_t guesses required
+	uint64_t orderOffset; //phraseNum int32_t, same as DifficultyIndex
+	int32_t bucketStart[28]; //Same as DifficultyIndex
+	int32_t tierStart[INVALID_DIFFICULTY + 1]; //Same as DifficultyIndex
+	uint32_t scored; //1 if the order is by scorePhrase misses first, 0 if only by guesses
+	uint64_t sourceHash; //contentHash of the whole text file it was compiled from
+};
 
-		//Turns the phrase to used so it won't be repeated
-		phraseArray[nextPhrase].isUsed = true;
+const char CORPUS_MAGIC[8] = {'H', 'A', 'N', 'G', 'C', 'O', 'R', 'P'};
+const uint32_t CORPUS_VERSION = 3; //Goes up when a section's layout or meaning changes
 
-		phrasesAsked++;
-	}while (playAgain());
+/*
+ *This struct is the start of a score cache file. After it come count
+ *phrase hashes in increasing order, then the misses for each of them.
+ */
+struct ScoreHeader
+{
+	char magic[8]; //Always SCORE_MAGIC
+	uint32_t version; //SCORE_VERSION when the file was written
+	uint32_t solver; //Low half of the contentHash of LETTER_FREQUENCY
+	uint64_t count; //Phrases scored
+};
 
-	cout << "You played " << phrasesAsked << " times." << endl;
+/*
+ *This struct holds the scores read from a cache file, sorted by hash.
+ */
+struct ScoreCache
+{
+	vector<uint64_t> hashes; //Hash of each phrase's text
+	vector<uint8_t> misses; //Misses the reference solver made on it
+};
 
-	return 0;
-}
+const char SCORE_MAGIC[8] = {'H', 'A', 'N', 'G', 'S', 'C', 'O', 'R'};
+const uint32_t SCORE_VERSION = 2; //Goes up if the reference solver changes
+constexpr string_view LETTER_FREQUENCY = "etaoinshrdlcumwfgypbvkjxqz"; //The reference solver's guesses, most common English letter first
 
-bool playAgain()
+/*
+ *This struct holds the replay log every finished game is appended to.
+ *Nothing is logged unless the HANGMAN_REPLAY environment variable names
+ *the file. Each thread collects records in its own ReplayBuffer and
+ *hands them over in batches. The writer thread takes every batch
+ *waiting at once and writes and syncs them together, so games from
+ *all threads share each sync.
+ */
+struct ReplayLog
 {
-	char yn;
-	cout << "Would you like to play again? (y/n): ";
-	cin >> yn;
-	cout << endl;
-	cin.clear();
-	cin.ignore(256, '\n');
+	bool enabled = false;
+	FILE* file = nullptr; //The log, opened for appending
+	mutex lock; //Guards pending and stopping
+	condition_variable wake; //Tells the writer a batch is waiting
+	vector<string> pending; //Batches handed over and not written yet
+	bool stopping = false; //Set when the program ends
+	thread writer; //Writes and syncs the pending batches
+	~ReplayLog();
+};
 
-	switch (yn)
-	{
-		case 'y':
-			return true;
-		case 'n':
-			return false;
-		default:
-			return false;
-	}
-}
+/*
+ *This struct holds the records one thread hasn't handed over yet. They
+ *are handed over once there are REPLAY_BATCH bytes, once the oldest has
+ *waited REPLAY_WAIT, or when the thread ends.
+ */
+struct ReplayBuffer
+{
+	string bytes; //Records back to back
+	chrono::steady_clock::time_point since; //When the oldest record was added
+	~ReplayBuffer();
+};
 
-void drawGallows(int missCount)
-{
-	// Output the top of the gallows
-	cout
-		<< "   +----+     \n"
-		<< "   |    |     \n";
-
-	// Output the stand and body
-	switch (missCount)
-	{
-	case 0:
-		cout
-			<< "   |       \n"
-			<< "   |       \n"
-			<< "   |       \n"
-			<< "   |       \n";
-		break;
-	case 1:
-		cout
-			<< "   |    O  \n"
-			<< "   |    |  \n"
-			<< "   |       \n"
-			<< "   |       \n";
-		break;
-	case 2:
-		cout
-			<< "   |    O  \n"
-			<< "   |   /|  \n"
-			<< "   |       \n"
-			<< "   |       \n";
-		break;
-	case 3:
-		// The '\\' will translate as \, because it is a special char
-		cout
-			<< "   |    O   \n"
-			<< "   |   /|\\ \n"
-			<< "   |        \n"
-			<< "   |        \n";
-		break;
-	case 4:
-		cout
-			<< "   |    O   \n"
-			<< "   |   /|\\ \n"
-			<< "   |     \\ \n"
-			<< "   |        \n";
-		break;
-	default:
-		cout
-			<< "   |    O    \n"
-			<< "   |   /|\\  \n"
-			<< "   |   / \\  \n"
-			<< "   |You're Dead\n";
-	}
-
-	// Output the base
-	cout << "  =============\n" << endl;
-}
-
-//FUNCTION PASSED, DON'T TOUCH
-int loadPhrasesFromFile(const string FILE_NAME, Phrase phraseArray[],
-    const int MAX_LENGTH)
-{
-    int length = 0;
-	int count = 0;
-    ifstream fileIn;
-    
-    //Open the file
-    fileIn.open(FILE_NAME);
+/*
+ *A replay log starts with REPLAY_MAGIC. After it, each game is a record
+ *of the phrase index, the low half of a hash of the phrase's text, the
+ *seed, a byte with the number of guesses and whether it was won in the
+ *top bit, then the guesses at 5 bits each, first in the lowest bits.
+ *Numbers are stored the way the machine that played stores them.
+ */
+const char REPLAY_MAGIC[8] = {'H', 'A', 'N', 'G', 'R', 'P', 'L', '1'};
+const size_t REPLAY_FIXED = 17; //Bytes in a record before the guesses
+const size_t REPLAY_BATCH = 1 << 16; //Bytes a thread collects before handing them over
+const chrono::milliseconds REPLAY_WAIT(100); //Longest a record waits while games go on
 
-    //what to do if the file doesn't exist.
-    if (fileIn.fail())
-        cout << "File does not exist" << endl;
-    else
-    {
-        //read the file into phraseArray by line until the file
-        //ends or the array maximum is met.
-        while (getline(fileIn, phraseArray[length].text, '\n') && length < MAX_LENGTH)
-		{
-			phraseArray[length].guessesRequired = uniqueLetterCount(phraseArray[length].text);
-			length++;
-		}
+/*
+ *This struct holds the versions of the loops over a whole phrase that
+ *this machine runs fastest, picked once: AVX2, SSE2, or plain C++.
+ *Every version gives the same answers.
+ */
+struct LetterKernels
+{
+	const char* name; //Which version these are
+	unsigned int (*letterMask)(const char* TEXT, const size_t LENGTH);
+	void (*renderBlanks)(const char* TEXT, const size_t LENGTH, 
+		const unsigned int SHOWN_MASK, char* out);
+	bool (*matchesPattern)(const char* TEXT, const size_t LENGTH, 
+		const char* BLANK_PHRASE, const unsigned int GUESSED_MASK);
+	bool (*isAscii)(const char* TEXT, const size_t LENGTH);
+	void (*letterMasks)(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+		uint32_t* masks);
+};
 
-		//Initialize remaining unused values.
-		count = length;
-		if (count != MAX_LENGTH)
-		{
-			while (count < MAX_LENGTH)
-			{
-				phraseArray[count++].text = 'A';
-			}
-		}
-    }
-    //Close the file
-    fileIn.close();
-    return length;
-}
+/**
+ * Adds the gallows to the frame. As the miss count increases, more of the
+ * person is displayed hanging from the gallows, spread over the rules'
+ * misses. Called in RunGame
+ */
+template <class R = StandardRules>
+void drawGallows(string& frame, int missCount);
 
-//WORKING, DON'T TOUCH
-bool maybeUnique(const string UNIQ_CHARS, char& ch)
-{
+/*
+ *Writes the frame to the screen all at once and empties it.
+ *Called in runGame and displayResult.
+ */
+void writeFrame(string& frame);
 
-	//make the character lowercase
-	toLower(ch);
+/*
+ *Loads a corpus from either a text file or a compiled corpus file,
+ *whichever FILE_NAME is. A text file is sorted, and scored with
+ *calibrateCorpus first if CALIBRATE is set. If FILE_NAME is a
+ *damaged compiled corpus, FALLBACK_FILE is loaded instead when there is
+ *one.  Returns the number of phrases.  Called in main, compileCorpus,
+ *and watchCorpus.
+ */
+int loadCorpus(const string FILE_NAME, Corpus& corpus, const bool REPORT = true,
+	const string FALLBACK_FILE = "", const bool CALIBRATE = false);
 
-	//Return false if its not a character
-	if (ch <= 97 || ch >= 122)
-		return false;
+/*
+ *Picks the compiled corpus if it was compiled from the text file as it
+ *is now, going by the hash of the text, otherwise the text file. The
+ *compiled corpus is used if there is no text file.
+ *Called in main and watchCorpus.
+ */
+string pickCorpusFile(const string TEXT_FILE, const string COMPILED_FILE);
 
-	//Check to see if the lowercase values equal anything already
-	//considered unique
+/*
+ *Works out the contentHash of a whole file, reading it in chunks.
+ *Returns false if it can't be read.
+ *Called in pickCorpusFile and compileCorpus.
+ */
+bool fileHash(const string FILE_NAME, uint64_t& hash);
+
+/*
+ *Reads in a file where each line is the text of a phrase. 
+ *The file is read whole in large chunks into the corpus's textArena, and
+ *the arrays grow to hold every line, so there is no maximum. Reports
+ *the load throughput unless REPORT is false.
+ *Returns the number of phrases.  Called in loadCorpus.
+ */
+int loadPhrasesFromFile(const string FILE_NAME, Corpus& corpus,
+	const bool REPORT = true);
+
+/*
+ *Splits the corpus's textArena into lines and adds a phrase for each,
+ *packing the text of the phrases together as it goes. Then works out
+ *every phrase's letters with one call to the letter kernels and points
+ *the corpus at its arenas. UTF-8 text is folded to plain letters first,
+ *and the folded text is what the phrase is from then on, so players
+ *see and guess "cafe" for a line that says "café".
+ *Called in loadPhrasesFromFile and makeSyntheticCorpus.
+ */
+void splitPhrases(Corpus& corpus);
+
+/*
+ *Rewrites UTF-8 text in place so accented Latin letters become the
+ *letters they are based on, like 'é' to 'e' and 'ß' to "ss", and drops
+ *combining accents and byte order marks. Anything else is kept as it
+ *is. The original bytes are gone afterwards. Returns the new length,
+ *which is never longer.
+ *Called in splitPhrases.
+ */
+size_t foldUtf8(char* text, const size_t LENGTH);
+
+/*
+ *Adds a single line of the file to the corpus's text and starts. The
+ *line's text is moved to the end of the text kept so far, which has to
+ *be at or before LINE in the textArena. Its letters are counted later.
+ *Carriage returns left over from Windows line endings are dropped, and
+ *so are empty lines.
+ *Called in splitPhrases.
+ */
+void addPhrase(const char* LINE, size_t length, Corpus& corpus);
+
+/*
+ *Points the corpus's arrays at its arenas and marks every phrase unused.
+ *Called in splitPhrases.
+ */
+void useArenas(Corpus& corpus);
+
+/*
+ *Returns the text of a phrase.
+ */
+string_view phraseText(const Corpus& CORPUS, const int PHRASE);
+
+/*
+ *Returns true if the phrase has been drawn from the pool since its
+ *level last started over.  Called in printPhrases.
+ */
+template <int LEVELS = INVALID_DIFFICULTY>
+bool isUsed(const BasicPhrasePool<LEVELS>& POOL, const int PHRASE);
+
+/*
+ *Loads a text file, sorts it, and writes it to OUT_FILE as a compiled
+ *corpus that loadCompiledCorpus can use without parsing anything. With
+ *CALIBRATE the phrases are scored first and the misses each level
+ *covers are reported.  Returns false if either file couldn't be used.
+ *Called in main and benchCorpus.
+ */
+bool compileCorpus(const string IN_FILE, const string OUT_FILE, 
+	const bool CALIBRATE = true);
+
+/*
+ *Maps a compiled corpus file into memory, or reads it in where that
+ *isn't possible, and points the phrases and difficulty index at it.
+ *Returns false if the file is missing or damaged.  Called in loadCorpus.
+ */
+bool loadCompiledCorpus(const string FILE_NAME, Corpus& corpus);
+
+/*
+ *Returns true if the file starts like a compiled corpus.
+ *Called in loadCorpus.
+ */
+bool isCompiledCorpus(const string FILE_NAME);
+
+/*
+ *Returns the bit for a letter from A-Z, case insensitive, so 'a' and 'A'
+ *are bit 0 and 'z' and 'Z' are bit 25. Punctuation, spaces, and anything
+ *else that isn't a letter return 0. Looked up in CHAR_TABLE.
+ *Called in buildLetterMask and checkGuess.
+ */
+unsigned int letterBit(char ch);
+
+/*
+ *Builds the set of letters in a single phrase in one pass, with one bit
+ *per letter as given by letterBit, using the letter kernels.
+ *Called in phraseWithBlanks, queryPattern, and benchCorpus.
+ */
+unsigned int buildLetterMask(const string_view SINGLE_PHRASE);
+
+/*
+ *Returns the letter kernels for this machine. They are AVX2 or SSE2 if
+ *the processor has them, unless the HANGMAN_SIMD environment variable
+ *asks for "sse2" or "scalar".  Called in buildLetterMask,
+ *phraseWithBlanks, pickGuess, and runBenchmarks.
+ */
+const LetterKernels& letterKernels();
+
+/*
+ *The plain C++ kernels. letterMask is the same as buildLetterMask.
+ *renderBlanks writes the phrase with blanks for the letters that aren't
+ *in SHOWN_MASK, the same as phraseWithBlanks, with a space after every
+ *character so out needs room for twice LENGTH. matchesPattern is the
+ *same as matchesPattern for a BLANK_PHRASE that fits. isAscii is true
+ *if no byte has its top bit set. letterMasks is letterMask for COUNT
+ *phrases laid out like a Corpus, phrase n being TEXT[STARTS[n]] up to
+ *TEXT[STARTS[n + 1]], so a whole corpus takes one call.
+ *Called in letterKernels.
+ */
+unsigned int scalarLetterMask(const char* TEXT, const size_t LENGTH);
+void scalarRenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out);
+bool scalarMatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK);
+bool scalarIsAscii(const char* TEXT, const size_t LENGTH);
+void scalarLetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/*
+ *The same kernels 16 characters at a time with SSE2, which every 64-bit
+ *x86 processor has.  Called in letterKernels.
+ */
+unsigned int sse2LetterMask(const char* TEXT, const size_t LENGTH);
+void sse2RenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out);
+bool sse2MatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK);
+bool sse2IsAscii(const char* TEXT, const size_t LENGTH);
+void sse2LetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks);
+
+/*
+ *The same kernels 32 characters at a time with AVX2.
+ *Called in letterKernels.
+ */
+__attribute__((target("avx2"))) 
+unsigned int avx2LetterMask(const char* TEXT, const size_t LENGTH);
+__attribute__((target("avx2"))) 
+void avx2RenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out);
+__attribute__((target("avx2"))) 
+bool avx2MatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK);
+__attribute__((target("avx2"))) 
+bool avx2IsAscii(const char* TEXT, const size_t LENGTH);
+__attribute__((target("avx2"))) 
+void avx2LetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks);
+
+/*
+ *Sorts out 16 characters for the SSE2 kernels: which are letters, the
+ *bit each letter has within its byte of a letter mask, and which byte of
+ *the mask that is, as 0, 8, 16, or 24.  Called in the SSE2 kernels.
+ */
+void sse2Classify(const __m128i CHARS, __m128i& isLetter, __m128i& bit, 
+	__m128i& group);
+
+/*
+ *Sets inMask to all ones for the letters among 16 classified characters
+ *that are in a letter mask, given as its 4 bytes each repeated across a
+ *vector.  Called in the SSE2 kernels.
+ */
+void sse2InMask(const __m128i IS_LETTER, const __m128i BIT, 
+	const __m128i GROUP, const __m128i MASK_BYTES[4], __m128i& inMask);
+
+/*
+ *The same as sse2Classify and sse2InMask for 32 characters with AVX2.
+ *Called in the AVX2 kernels.
+ */
+__attribute__((target("avx2"))) 
+void avx2Classify(const __m256i CHARS, __m256i& isLetter, __m256i& bit, 
+	__m256i& group);
+__attribute__((target("avx2"))) 
+void avx2InMask(const __m256i IS_LETTER, const __m256i BIT, 
+	const __m256i GROUP, const __m256i MASK_BYTES[4], __m256i& inMask);
+#endif
+
+/*
+ *The purpose of this function is to only allow unique characters from
+ *A-Z to count as case insensitive unique characters. Returns true if ch
+ *is a letter that isn't already in UNIQ_MASK.
+ *Called in scalarMatchesPattern and pickGuess.
+ */
+bool maybeUnique(const unsigned int UNIQ_MASK, char ch);
+
+/*
+ *This function takes a letter mask and returns the number of unique
+ *letters in it.  Called in splitPhrases and benchCorpus.
+ */
+int uniqueLetterCount(const unsigned int LETTER_MASK);
+
+/*
+ *Outputs the phrases after the guesses and use are known
+ *Used for testing, so not called.
+ */
+void printPhrases(const Corpus& CORPUS, const PhrasePool& POOL);
+
+/*
+ *This function sorts the phrases based on the number of guesses that are
+ *required to complete the phrase, using a counting sort on the phrase
+ *indexes. With MISSES, phrases are sorted by those first. The phrases
+ *themselves are not moved. Splits the sorted order into the difficulty
+ *levels. Called in loadCorpus and benchCorpus.
+ */
+DifficultyIndex sortPhrases(const Corpus& CORPUS, const uint8_t* MISSES = nullptr);
+
+/*
+ *Scores every phrase by how many misses the reference solver makes on
+ *it. Scores for phrases seen before come from SCORES_FILE by the hash of
+ *their text, and only the rest are played, split between every core.
+ *The file is then rewritten with the scores of this corpus. The solver
+ *only looks at the phrase, so a score never depends on the corpus.
+ *Returns the misses for each phrase.  Called in loadCorpus.
+ */
+vector<uint8_t> calibrateCorpus(const Corpus& CORPUS, const string SCORES_FILE,
+	const bool REPORT);
+
+/*
+ *Plays the phrase with the letters in LETTER_MASK by guessing in
+ *LETTER_FREQUENCY order, with no limit on misses, and returns how many
+ *misses it took.  Called in calibrateCorpus and compileCorpus.
+ */
+uint8_t scorePhrase(const unsigned int LETTER_MASK);
+
+/*
+ *Returns the FNV-1a hash of a phrase's text. Passing the HASH of the
+ *text before it carries on from there.
+ *Called in calibrateCorpus, fileHash, the score cache, and the replay log.
+ */
+uint64_t contentHash(const string_view TEXT, const uint64_t HASH = 14695981039346656037ull);
+
+/*
+ *Reads a score cache. Returns false, with the cache empty, if the file
+ *is missing, damaged, or from another version or solver.
+ *Called in calibrateCorpus.
+ */
+bool readScoreCache(const string FILE_NAME, ScoreCache& cache);
+
+/*
+ *Writes a score cache, replacing the old file only once the new one is
+ *complete. Returns false if it couldn't.  Called in calibrateCorpus.
+ */
+bool writeScoreCache(const string FILE_NAME, const ScoreCache& CACHE);
+
+/*
+ *The purpose of this function is to display the current phrase 
+ *with blanks including the correctly guessed character. When every
+ *guess is a letter the letter kernels render it.
+ *Function called in runGame
+ */
+string phraseWithBlanks(const string_view CURRENT_PHRASE, const string_view CORRECT_GUESSES);
+
+/*
+ *Builds the reveal state for a phrase before any guesses, grouping the
+ *position of every letter so it can be revealed without a rescan.
+ *Called in runGame.
+ */
+template <class R = StandardRules>
+BasicReveal<R> startReveal(const string_view SINGLE_PHRASE);
+
+/*
+ *Fills in every position of a correctly guessed letter in the phrase
+ *with blanks and counts the letter as found.  Called in checkGuess.
+ */
+template <class R>
+void revealLetter(BasicReveal<R>& reveal, const typename R::Mask LETTER_BIT);
+
+/*
+ *The purpose of this function is to support phraseWithBlanks to find out
+ *what value should be passed to the string that holds the blanks.
+ *It can only be used when Correct guesses is longer than 0.
+ *Called in phraseWithBlanks.
+ */
+char withGuesses(char currentVal, char guessVal);
+
+/*
+ *The purpose of this function is to support phraseWithBlanks to find out
+ *what value should be passed to the string that holds the blanks.
+ *It can only be used when Correct guesses is 0 length.
+ *Called in phraseWithBlanks.
+ */
+char withoutGuesses(char currentVal);
+
+/*
+ *The purpose of this function is to get the difficulty level from the user.
+ *Function called in main.
+ */
+DifficultyLevel getDifficultyLevel();
+
+/*
+ *Asks for one of LEVELS levels, easiest first, for rules that don't
+ *have the usual three. Returns the level counting from 0.
+ *Called in playRounds.
+ */
+int chooseLevel(const int LEVELS);
+
+/*
+ *Returns the name of a level: the usual names with three levels, or
+ *its number with any other count.  Called in randomPhraseIndex.
+ */
+template <int LEVELS>
+string levelName(const int LEVEL);
+
+/*
+ *The purpose of this function is to declare values for the enumeration type
+ *that correspond to a string.  This function is called in main.
+*/
+string convertDifficulty(DifficultyLevel diff);
+
+/*
+ *Fills a pool with every phrase in the index, all of them unused.
+ *Called in playRounds.
+ */
+template <int LEVELS = INVALID_DIFFICULTY>
+BasicPhrasePool<LEVELS> buildPhrasePool(const DifficultyIndex& INDEX);
+
+/*
+ *This function is to get the index of the next phrase to be used.
+ * It gets this based off the difficulty that the user chooses, and
+ * draws from the phrases that haven't been used, marking the one it
+ * picks as used. A level that has run out starts a new epoch first.
+ * Takes the same time no matter how many have been used. A level
+ * without phrases borrows from the next harder one. Returns -1 if the
+ * difficulty isn't a level.  Called in playRounds.
+ */
+template <int LEVELS>
+int randomPhraseIndex(int diff, BasicPhrasePool<LEVELS>& pool, Random& rng);
+
+/*
+ *Starts a random number stream for a seed. Different streams from the
+ *same seed don't overlap.  Called in main and simulateGame.
+ */
+Random seedRandom(const uint64_t SEED, const uint64_t STREAM);
+
+/*
+ *Returns the next random number in the stream.  Called in randomBelow.
+ */
+uint64_t nextRandom(Random& rng);
+
+/*
+ *Returns a random number from 0 up to but not including BOUND.
+ *Called in randomPhraseIndex and simulateGame.
+ */
+unsigned int randomBelow(Random& rng, const unsigned int BOUND);
+
+/*
+ *Once main has assembled and sorted all information needed to run
+ *the game, this function is called to run a single Hangman game
+ *on the console. If there is a BOT it makes the guesses instead of
+ *the user. With HINTS, a guess of '?' shows how many phrases still fit
+ *and a letter to try, building the index the first time. The bot and
+ *hints only play by the standard rules.
+ *Called in playRounds.
+ */ 
+template <class R = StandardRules>
+void runGame(const Corpus& CORPUS, const int PHRASE_INDEX,
+	const Solver* BOT = nullptr, PatternIndex* hints = nullptr);
+
+/*
+ *Sets up a new game for one phrase with no guesses made.
+ *Called in runGame.
+ */
+template <class R = StandardRules>
+BasicGame<R> startGame(const Corpus& CORPUS, const int PHRASE_INDEX);
+
+/*
+ *Plays a single guess in a game without any input or output and returns
+ *what happened. The guess may be upper or lowercase. With telemetry on
+ *it counts the result, times some of the guesses, and counts the game
+ *for its phrase at its first guess and again once it is over.
+ *Called in runGame.
+ */
+template <class R>
+GuessResult playGuess(BasicGame<R>& game, char userGuess);
+
+/*
+ *Returns true once the game has been won or lost.
+ *Called in playGuess and runGame.
+ */
+template <class R>
+bool gameOver(const BasicGame<R>& GAME);
+
+/*
+ *Adds a guess to the telemetry: its result, the game's first real guess
+ *as a play of the phrase, and the win and misses once it is over. A
+ *PHRASE_INDEX of -1 only counts the result.
+ *Called in playGuess and playCompactGuess.
+ */
+void countGuess(const int PHRASE_INDEX, const GuessResult RESULT, 
+	const unsigned int GUESSES, const unsigned int MISSES);
+
+/*
+ *Sets up a compact game for one phrase with no guesses made.
+ *Called in handleRequest and runBatch.
+ */
+CompactGame startCompactGame(const int PHRASE_INDEX);
+
+/*
+ *Checks a guess in a compact game against the phrase's letter mask, by
+ *the same rules as checkGuess, with nothing but bit operations. WON and
+ *LOST are returned for the guess that finished the game, and for any
+ *guess after.  Called in playCompactGuess and runBatch.
+ */
+GuessResult checkCompactGuess(CompactGame& game, const unsigned int PHRASE_MASK, 
+	const char USER_GUESS);
+
+/*
+ *Plays a guess in a compact game like playGuess does for a Game,
+ *adding it to the game's history, counting it in the telemetry, and
+ *logging the game once it is over.  Called in handleRequest.
+ */
+GuessResult playCompactGuess(CompactGame& game, GuessHistory& history, 
+	const Corpus& CORPUS, const char USER_GUESS, const uint64_t SEED);
+
+/*
+ *Returns the phrase with blanks for a compact game, the same way the
+ *player sees it.  Called in handleRequest.
+ */
+string compactBlanks(const Corpus& CORPUS, const CompactGame& GAME);
+
+/*
+ *This function checks the user's character guess against the letter
+ *mask of the phrase and determines whether it is valid, previously
+ *guessed, right, or wrong.  Right guesses are revealed.
+ *Called in playGuess.
+ */
+template <class R>
+GuessResult checkGuess(const char USER_GUESS, const typename R::Mask PHRASE_MASK, 
+	BasicGuesses<R> guess[], BasicReveal<R>& reveal);
+
+/*
+ *Adds what happened with the user's guess to the frame.
+ *Called in runGame.
+ */
+void showGuessResult(string& frame, const GuessResult RESULT, const char USER_GUESS);
+
+/*Display Result shows the results of the win or loss, after whatever
+ *is already in the frame.  Called in runGame.
+ */
+template <class R = StandardRules>
+void displayResult(string& frame, int wrongGuesses, 
+	const string_view PHRASE, const string BLANK_PHRASE);
+
+/*
+ *Play again asks the user if they want to play again and
+ * returns true if so, false if not.  Called in main.
+ */
+bool playAgain();
+
+/*
+ *This function makes Uppercase characters into lowercase.
+ * Called in maybe unique and run Game
+ */ 
+char toLower(char uGuess);
+
+/*
+ *Returns true once every letter in the phrase has been revealed.
+ *Called in runGame.
+ */
+template <class R>
+bool checkVictory(const BasicReveal<R>& REVEAL);
+
+/*
+ *Gets the solver ready to play with the loaded phrases. The budget is
+ *the most microseconds it may take to pick a single letter, or 0 for no
+ *limit.
+ *Called in main.
+ */
+Solver buildSolver(const Corpus& CORPUS,
+	const SolverStrategy STRATEGY, const double BUDGET_MICROS);
+
+/*
+ *Starts the solver's state for a game, with every phrase the same
+ *length as the one being guessed as a candidate.
+ *Called in runGame and solveCorpus.
+ */
+SolverGame startSolverGame(const Solver& SOLVER, const Game& GAME);
+
+/*
+ *Picks the solver's next guess from the phrase with blanks and the
+ *letters already guessed. Falls back to the frequency order if
+ *eliminating phrases would go over the time budget.
+ *Called in runGame and solveCorpus.
+ */
+char pickGuess(const Solver& SOLVER, SolverGame& solverGame, const Game& GAME);
+
+/*
+ *Returns true if a phrase could be the answer for a phrase with blanks,
+ *given every letter that has been guessed.  Called in pickGuess.
+ */
+bool matchesPattern(const string_view TEXT, const string& BLANK_PHRASE,
+	const unsigned int GUESSED_MASK);
+
+/*
+ *Builds the pattern index for every phrase in the corpus.
+ *Called in runGame and benchCorpus.
+ */
+PatternIndex buildPatternIndex(const Corpus& CORPUS);
+
+/*
+ *Returns the hash of a phrase's shape, with every letter in it, or
+ *every blank in a phrase with blanks, as the same character. STEP is 1
+ *for a phrase, or 2 for a phrase with blanks.
+ *Called in buildPatternIndex and queryPattern.
+ */
+uint64_t shapeKey(const string_view TEXT, const size_t STEP);
+
+/*
+ *Finds the phrases that fit a phrase with blanks, shown the same way
+ *as phraseWithBlanks, and don't have any of the wrong guesses.
+ *Returns the number found.  Called in showHint and benchCorpus.
+ */
+int queryPattern(const PatternIndex& INDEX, const string& BLANK_PHRASE,
+	const string& WRONG_GUESSES, PatternMatches& matches);
+
+/*
+ *Returns the phrase indexes of the matches.  Called in benchCorpus.
+ */
+vector<int> matchingPhrases(const PatternIndex& INDEX, const PatternMatches& MATCHES);
+
+/*
+ *Adds how many phrases fit the game so far to the frame, along with
+ *the unguessed letter the most of them have.  Called in runGame.
+ */
+void showHint(string& frame, const PatternIndex& INDEX, const Game& GAME);
+
+/*
+ *Returns the program's telemetry, reading HANGMAN_TELEMETRY the first
+ *time. When it is on, the report is written as the program exits.
+ *Called in startGame, playGuess, runGame, sortPhrases, the corpus
+ *loaders, handleRequest, and main.
+ */
+Telemetry& telemetry();
+
+/*
+ *Returns this thread's shard, making it the first time.
+ *Called in playGuess and runGame.
+ */
+TelemetryShard& telemetryShard();
+
+/*
+ *Adds one to a counter only this thread writes.
+ *Called in playGuess and recordLatency.
+ */
+void bumpCounter(atomic<uint64_t>& counter);
+
+/*
+ *Adds a time to the histogram bucket for its power of two.
+ *Called in playGuess and runGame.
+ */
+void recordLatency(atomic<uint64_t> buckets[], const chrono::nanoseconds TIME);
+
+/*
+ *Adds the time since START to a step.  Called in sortPhrases and the
+ *corpus loaders.
+ */
+void recordStep(const TimedStep STEP, const chrono::steady_clock::time_point START);
+
+/*
+ *Makes room for a count for every phrase in the corpus. Any counts
+ *from before are dropped. Only games on this corpus are counted by
+ *phrase.  Called in main.
+ */
+void sizeTelemetry(const Corpus& CORPUS);
+
+/*
+ *Adds up every thread's counts and writes the report. Returns false if
+ *the file couldn't be written.  Called in handleRequest and telemetry.
+ */
+bool writeTelemetry(const string FILE_NAME);
+
+/*
+ *Returns the program's replay log, reading HANGMAN_REPLAY and starting
+ *the writer the first time.  Called in playGuess, ReplayBuffer, and
+ *main.
+ */
+ReplayLog& replayLog();
+
+/*
+ *Waits for batches and writes each group of them, then syncs once,
+ *until the log is stopping and nothing is left.
+ *Called in replayLog.
+ */
+void writeReplayBatches(ReplayLog& log);
+
+/*
+ *Hands a thread's records to the writer and empties them.
+ *Called in appendReplay and ReplayBuffer.
+ */
+void handOverReplay(string& bytes);
+
+/*
+ *Adds a finished game to this thread's records. The phrase is put back
+ *together from the reveal state for its hash.  Called in playGuess.
+ */
+void logGame(const Game& GAME, const bool WON);
+
+/*
+ *Adds a finished compact game to this thread's records, with its
+ *guesses in the order of its history.  Called in playCompactGuess.
+ */
+void logCompactGame(const Corpus& CORPUS, const CompactGame& GAME, 
+	const GuessHistory& HISTORY, const uint64_t SEED, const bool WON);
+
+/*
+ *Returns this thread's records that haven't been handed over yet.
+ *Called in appendReplay and flushStaleReplay.
+ */
+ReplayBuffer& replayBuffer();
+
+/*
+ *Hands over this thread's records once the oldest has waited
+ *REPLAY_WAIT, for threads that may go quiet between games. Returns true
+ *if records are still waiting.  Called in serverLoop.
+ */
+bool flushStaleReplay(const chrono::steady_clock::time_point NOW);
+
+/*
+ *Adds one record to this thread's records, handing them over if there
+ *are enough or they have waited long enough.
+ *Called in logGame and logCompactGame.
+ */
+void appendReplay(const uint32_t PHRASE, const uint32_t CHECK, const uint64_t SEED,
+	const string_view GUESSES, const bool WON);
+
+/*
+ *Streams a replay log back through the game, checking every record
+ *still gives the same result on the loaded phrases, and reports how
+ *the games went by difficulty level.  Returns false if the log can't
+ *be read or is damaged.  Called in main.
+ */
+bool replayGames(const Corpus& CORPUS, const string FILE_NAME);
+
+/*
+ *Plays scripted games from a file, or standard input for "-", with no
+ *prompts or drawing. Each line is a phrase index and the guesses for
+ *it, like "42 etaoin". Writes a line for each game to standard output
+ *with the phrase index, WON, LOST, or OPEN if the guesses ran out
+ *first, the misses, and the guesses that counted. A line without a
+ *phrase gets its first word and INVALID. Returns false if the file
+ *can't be opened.  Called in main.
+ */
+bool runBatch(const Corpus& CORPUS, const string FILE_NAME);
+
+/*
+ *Has the solver play every phrase once and reports the win rate,
+ *guesses per game, and how long each guess took.  Called in main.
+ */
+void solveCorpus(const Corpus& CORPUS, const Solver& SOLVER);
+
+/*
+ *Turns the name of a strategy into the SolverStrategy.
+ *Called in main.
+ */
+SolverStrategy convertStrategy(const string NAME);
+
+/*
+ *Plays GAMES games with the solver on THREADS threads and reports the
+ *results, the games per second, and how well that scaled compared to a
+ *single thread. The results are the same for a seed no matter how many
+ *threads play.  Called in main.
+ */
+void simulateGames(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const long long GAMES, const uint64_t SEED, 
+	const unsigned int THREADS);
+
+/*
+ *Plays the games in [FIRST, LAST) on THREADS threads, with the games
+ *split between them and stolen when one runs out.  Returns the totals
+ *from every thread added together.  Called in simulateGames.
+ */
+SimulationTotals runSimulation(const Corpus& CORPUS, 
+	const DifficultyIndex& INDEX, const Solver& SOLVER, const uint32_t FIRST,
+	const uint32_t LAST, const uint64_t SEED, const unsigned int THREADS);
+
+/*
+ *Gets the next games for a worker to play, first from its own range and
+ *then from the other workers.  Returns false once every game is taken.
+ *Called in runSimulation.
+ */
+bool takeWork(WorkRange ranges[], const unsigned int WORKERS, 
+	const unsigned int SELF, uint32_t& first, uint32_t& last);
+
+/*
+ *Plays a single simulated game, picking its difficulty and phrase from
+ *the game's own random stream, and adds it to the totals.
+ *Called in runSimulation.
+ */
+void simulateGame(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const uint64_t SEED, const uint32_t GAME_NUMBER,
+	SimulationTotals& totals);
+
+/*
+ *Picks a random phrase from a difficulty level. Empty levels use the
+ *next harder one like randomPhraseIndex, but nothing is marked used so
+ *it can be shared between threads.  Called in simulateGame and
+ *handleRequest.
+ */
+int randomTierPhrase(const DifficultyIndex& INDEX, int diff, Random& rng);
+
+/*
+ *Turns a GuessResult into the word the server sends for it.
+ *Called in handleRequest.
+ */
+string convertGuessResult(GuessResult result);
+
+/*
+ *Runs the game server on PORT until it is stopped, with THREADS event
+ *loops that share the phrases and the session table. Each request is
+ *one line: "new 1" to "new 3" starts a game at that difficulty and
+ *replies with its id, a single letter guesses it, and "resume" with an
+ *id picks a game back up from any connection. Games nobody touches for
+ *SESSION_TTL are dropped. "stats" writes the telemetry report when it
+ *is on. The phrases are loaded again whenever
+ *TEXT_FILE or COMPILED_FILE changes, without stopping any games.
+ *Only available on Linux.  Called in main.
+ */
+void runServer(const Corpus& CORPUS, const string TEXT_FILE, 
+	const string COMPILED_FILE, const int PORT, const unsigned int THREADS);
+
+/*
+ *Answers a single line from a player and adds the reply to their
+ *session's output. New games are dealt from LATEST and kept in TABLE.
+ *Called in serverLoop.
+ */
+void handleRequest(ServerSession& session, const string& LINE,
+	const shared_ptr<const Corpus>& LATEST, SessionTable& table, Random& rng);
+
+/*
+ *Returns the shard a game id belongs to.
+ *Called in storeGame, handleRequest, and evictSessions.
+ */
+SessionShard& sessionShard(SessionTable& table, const uint64_t GAME_ID);
+
+/*
+ *Puts a new game in the table under a random id and returns the id.
+ *Returns 0 if its shard is full even after dropping old games.
+ *Called in handleRequest.
+ */
+uint64_t storeGame(SessionTable& table, const CompactGame& GAME, const uint64_t SEED,
+	const shared_ptr<const Corpus>& CORPUS);
+
+/*
+ *Returns a game id from the system's secure random numbers, never 0.
+ *Ids have nothing to do with the stream phrases are dealt from, so
+ *seeing some ids doesn't tell anyone the next ones.
+ *Called in storeGame.
+ */
+uint64_t randomGameId();
+
+/*
+ *Drops the games untouched for SESSION_TTL from every STEP'th shard,
+ *starting at FIRST, one shard locked at a time.  Called in serverLoop.
+ */
+void evictSessions(SessionTable& table, const unsigned int FIRST, 
+	const unsigned int STEP, const chrono::steady_clock::time_point NOW);
+
+/*
+ *Connects LOAD_SESSIONS players to the server at HOST and PORT on
+ *THREADS threads. Each plays GAMES games, guessing letters from most to
+ *least common and waiting about THINK_MS milliseconds between requests.
+ *Reports the requests per second and the latency of each request.
+ *Only available on Linux.  Called in main.
+ */
+void runLoadGenerator(const string HOST, const int PORT, const int LOAD_SESSIONS,
+	const int GAMES, const unsigned int THREADS, const int THINK_MS);
+
+/*
+ *Plays GAMES games with the solver all at the same time on one thread,
+ *each one a suspended coroutine, giving each game a guess in turn.
+ *Reports the games per second and the size of each game's frame.
+ *Needs C++20.  Called in main.
+ */
+void interleaveGames(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const long long GAMES, const uint64_t SEED);
+
+#if __cpp_impl_coroutine >= 201902L
+/*
+ *Starts a game as a coroutine. It sets up the game and suspends until
+ *its first guess, or finishes right away as a win if the phrase has no
+ *letters.  Called in interleaveGames.
+ */
+GameTask playGameTask(const Corpus& CORPUS, const int PHRASE_INDEX);
+
+/*
+ *Resumes a suspended game with its next guess and returns what the
+ *guess did.  Called in interleaveGames.
+ */
+GuessResult resumeGame(GameTask& task, const char GUESS);
+
+/*
+ *Returns true once the game has finished and won't take more guesses.
+ *Called in interleaveGames.
+ */
+bool taskDone(const GameTask& TASK);
+
+/*
+ *Returns the game inside a task, which stays valid until the task is
+ *destroyed.  Called in interleaveGames.
+ */
+const Game& taskGame(const GameTask& TASK);
+
+/*
+ *Returns the frames of finished games this thread keeps to reuse.
+ *Called in the GameTask promise's operator new and delete.
+ */
+FramePool& spareFrames();
+#endif
+
+#ifdef __linux__
+/*
+ *One thread of the server: accepts connections on its own listening
+ *socket and handles every request that comes in on them.
+ *Called in runServer.
+ */
+void serverLoop(const CorpusFeed& FEED, SessionTable& table, const int PORT, 
+	const unsigned int WORKER, const unsigned int THREADS);
+
+/*
+ *Waits for TEXT_FILE or COMPILED_FILE to be written or replaced, then
+ *loads the phrases on this thread and publishes them to the feed. Old
+ *corpora are freed here too, once no game is using them, so the event
+ *loops never pay for it.  Called in runServer.
+ */
+void watchCorpus(CorpusFeed& feed, const string TEXT_FILE, const string COMPILED_FILE);
+
+/*
+ *Opens a non-blocking socket listening on PORT. Every server thread has
+ *its own and the kernel spreads new connections between them.
+ *Returns -1 if it couldn't.  Called in serverLoop.
+ */
+int openListener(const int PORT);
+
+/*
+ *Sends as much of the output as the socket will take right now.
+ *Returns false if the connection is broken.
+ *Called in serverLoop and sendLoadRequest.
+ */
+bool flushOutput(const int FD, string& out);
+
+/*
+ *One thread of the load generator, playing its share of the sessions.
+ *The latency of every request is added to latencies.
+ *Called in runLoadGenerator.
+ */
+void loadLoop(const string HOST, const int PORT, const int LOAD_SESSIONS,
+	const int GAMES, const int THINK_MS, const unsigned int WORKER,
+	vector<uint32_t>& latencies);
+
+/*
+ *Sends a session's next request, either a new game or its next guess.
+ *Called in loadLoop.
+ */
+void sendLoadRequest(LoadSession& session, const bool NEW_GAME);
+
+/*
+ *Lets the process have as many sockets open as the system allows.
+ *Called in runServer and runLoadGenerator.
+ */
+void raiseFileLimit();
+#endif
+
+/*
+ *Times uniqueLetterCount, maybeUnique, phraseWithBlanks, withGuesses,
+ *checkGuess, checkVictory, sortPhrases, loadPhrasesFromFile, and
+ *loadCompiledCorpus on made up corpora from 100 phrases up to MAX_PHRASES,
+ *with short and long phrases. The fastest of three runs is kept. Writes
+ *the results to bench_output.txt as CSV and compares them to
+ *BASELINE_FILE if there is one. Returns true if anything got more than
+ *10% slower than the baseline.  Called in main.
+ */
+bool runBenchmarks(const long long MAX_PHRASES, const string BASELINE_FILE);
+
+/*
+ *Fills the corpus with COUNT phrases of random words with lengths from
+ *MIN_LENGTH to MAX_LENGTH, the same way loadPhrasesFromFile would have
+ *loaded them.  Called in runBenchmarks.
+ */
+void makeSyntheticCorpus(const long long COUNT, const int MIN_LENGTH,
+	const int MAX_LENGTH, Random& rng, Corpus& corpus);
+
+/*
+ *Times every benchmark on a single corpus and adds the results. Each
+ *benchmark goes through the corpus REPEAT times.
+ *Called in runBenchmarks.
+ */
+void benchCorpus(const Corpus& CORPUS, const string LENGTHS,
+	const int REPEAT, vector<BenchResult>& results);
+
+/*
+ *Compares the results against a baseline file written by an earlier run
+ *and shows the change for each one.  Returns true if anything got more
+ *than 10% slower.  Called in runBenchmarks.
+ */
+bool compareBaseline(const vector<BenchResult>& RESULTS, const string BASELINE_FILE);
+
+/*
+ *Asks for a level and plays games on the console by the rules R until
+ *the user stops, then says how many were played. The BOT only plays by
+ *the standard rules.  Called in main and playVariant.
+ */
+template <class R>
+void playRounds(Corpus& corpus, const Solver* BOT);
+
+/*
+ *Plays on the console by the rules variant with the given NAME.
+ *Returns false if there is no variant by that name.  Called in main.
+ */
+bool playVariant(Corpus& corpus, const string NAME);
+
+int main(int argc, char* argv[])
+{
+    const string FILE_NAME = "phrases.txt"; //Name of file to load from
+	const string COMPILED_NAME = "phrases.hmc"; //Compiled copy of FILE_NAME
+
+	//The first argument picks the mode, the rest are for that mode.
+	const string MODE = argc > 1 ? argv[1] : "";
+
+	//Play against a server instead of loading any phrases.
+	if (MODE == "--loadgen")
+	{
+		runLoadGenerator(argc > 2 ? argv[2] : "127.0.0.1", 
+			argc > 3 ? atoi(argv[3]) : 7777, argc > 4 ? atoi(argv[4]) : 1000,
+			argc > 5 ? atoi(argv[5]) : 10, 
+			argc > 6 ? static_cast<unsigned int>(atoi(argv[6])) : 1,
+			argc > 7 ? atoi(argv[7]) : 0);
+		return 0;
+	}
+
+	//Time the hot functions on made up phrases instead of playing.
+	if (MODE == "--bench")
+		return runBenchmarks(argc > 2 ? atoll(argv[2]) : 1000000,
+			argc > 3 ? argv[3] : "") ? 1 : 0;
+
+	//Compile a text file so later runs can start without parsing it.
+	if (MODE == "--compile")
+		return compileCorpus(argc > 2 ? argv[2] : FILE_NAME, 
+			argc > 3 ? argv[3] : COMPILED_NAME) ? 0 : 1;
+
+	//Holds the phrases, guesses required, and uses.
+    Corpus corpus;
+
+	//initializes the corpus to the phrases in the file, compiled if it can be
+    //Holds the actual number of phrases in MAX_USED_INDEX
+	//Initialize the array with the number of unique characters/min guesses.
+    const int MAX_USED_INDEX = loadCorpus(pickCorpusFile(FILE_NAME, COMPILED_NAME),
+		corpus, MODE != "--batch", FILE_NAME);
+
+	//Nothing to play without phrases.
+	if (MAX_USED_INDEX == 0)
+	{
+		cout << "No phrases to play." << endl;
+		return 1;
+	}
+
+	//Count plays for every phrase if telemetry is on.
+	if (telemetry().enabled)
+		sizeTelemetry(corpus);
+
+	//Play a replay log back and report on the games in it.
+	if (MODE == "--replay")
+		return replayGames(corpus, argc > 2 ? argv[2] : "replay.log") ? 0 : 1;
+
+	//Play scripted guesses with only the results written out.
+	if (MODE == "--batch")
+		return runBatch(corpus, argc > 2 ? argv[2] : "-") ? 0 : 1;
+
+	//Let the solver play every phrase instead of the user.
+	if (MODE == "--solve")
+	{
+		const Solver SOLVER = buildSolver(corpus,
+			convertStrategy(argc > 2 ? argv[2] : "elimination"),
+			argc > 3 ? atof(argv[3]) : 50);
+		solveCorpus(corpus, SOLVER);
+		return 0;
+	}
+
+	//The phrases sorted based on their guesses required.
+	const DifficultyIndex& INDEX = corpus.index;
+
+	//Let the solver play lots of games on every core. Without a budget
+	//the solver always picks the same way, so the results are repeatable.
+	if (MODE == "--simulate")
+	{
+		const Solver SOLVER = buildSolver(corpus,
+			convertStrategy(argc > 5 ? argv[5] : "elimination"), 0);
+		const unsigned int CORES = thread::hardware_concurrency();
+		simulateGames(corpus, INDEX, SOLVER, 
+			argc > 2 ? atoll(argv[2]) : 1000000,
+			argc > 3 ? strtoull(argv[3], nullptr, 10) : 1,
+			argc > 4 ? static_cast<unsigned int>(atoi(argv[4])) : max(CORES, 1u));
+		return 0;
+	}
+
+	//Serve games over the network instead of the console.
+	if (MODE == "--serve")
+	{
+		const unsigned int CORES = thread::hardware_concurrency();
+		runServer(corpus, FILE_NAME, COMPILED_NAME, argc > 2 ? atoi(argv[2]) : 7777,
+			argc > 3 ? static_cast<unsigned int>(atoi(argv[3])) : max(CORES, 1u));
+		return 0;
+	}
+
+	//Let the solver play lots of games at once on one thread.
+	if (MODE == "--interleave")
+	{
+		const Solver SOLVER = buildSolver(corpus,
+			convertStrategy(argc > 4 ? argv[4] : "frequency"), 0);
+		interleaveGames(corpus, INDEX, SOLVER, 
+			argc > 2 ? atoll(argv[2]) : 100000,
+			argc > 3 ? strtoull(argv[3], nullptr, 10) : 1);
+		return 0;
+	}
+
+	//Play by other rules if asked, each one its own specialized game.
+	if (MODE == "--rules")
+		return playVariant(corpus, argc > 2 ? argv[2] : "") ? 0 : 1;
+
+	//Let the solver make the guesses in the regular game.
+	if (MODE == "--bot")
+	{
+		const Solver BOT = buildSolver(corpus,
+			convertStrategy(argc > 2 ? argv[2] : "elimination"), 
+			argc > 3 ? atof(argv[3]) : 50);
+		playRounds<StandardRules>(corpus, &BOT);
+		return 0;
+	}
+
+	playRounds<StandardRules>(corpus, nullptr);
+
+	return 0;
+}
+
+template <class R>
+void playRounds(Corpus& corpus, const Solver* BOT)
+{
+	//holds the number of phrases the user plays
+	int phrasesAsked = 0;
+
+	//holds the index value for the next phrase to be played
+	int nextPhrase = -1;
+
+	//Every phrase starts out unused.
+	BasicPhrasePool<R::LEVELS> pool = buildPhrasePool<R::LEVELS>(corpus.index);
+
+	//Built the first time the user asks for a hint.
+	PatternIndex hints;
+
+	//Seed the random number generator using the current time.
+	Random rng = seedRandom(static_cast<uint64_t>(time(nullptr)), 0);
+
+	//Find the difficulty the user wants to play at.
+	const int DIFFICULTY = R::LEVELS == INVALID_DIFFICULTY ? 
+		static_cast<int>(getDifficultyLevel()) : chooseLevel(R::LEVELS);
+
+	do
+	{
+		//Find the next phrase based on the difficulty
+		//The phrase is turned to used so it won't be repeated
+		nextPhrase = randomPhraseIndex(DIFFICULTY, pool, rng);
+
+		//Show the user their current hangman, and show the phrase with blanks.
+		//Then, ask them for their guesses, and re-display based on that guess.
+		runGame<R>(corpus, nextPhrase, BOT, &hints);
+
+		phrasesAsked++;
+	}while (playAgain());
+
+	cout << "You played " << phrasesAsked << " times." << endl;
+}
+
+bool playVariant(Corpus& corpus, const string NAME)
+{
+	if (NAME == "seven")
+		playRounds<SevenMissRules>(corpus, nullptr);
+	else if (NAME == "digits")
+		playRounds<DigitRules>(corpus, nullptr);
+	else if (NAME == "exact")
+		playRounds<ExactCaseRules>(corpus, nullptr);
+	else if (NAME == "five")
+		playRounds<FiveLevelRules>(corpus, nullptr);
+	else
+	{
+		cout << "Rules are seven (7 misses), digits (digits are guessed too), "
+			"exact (case matters), or five (5 levels)" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool playAgain()
+{
+	char yn;
+	cout << "Would you like to play again? (y/n): ";
+	cin >> yn;
+	cout << endl;
+	cin.clear();
+	cin.ignore(256, '\n');
+
+	switch (yn)
+	{
+		case 'y':
+			return true;
+		case 'n':
+			return false;
+		default:
+			return false;
+	}
+}
+
+template <class R>
+void drawGallows(string& frame, int missCount)
+{
+	//Spread the drawings over the rules' misses, the whole person only
+	//shows at the last one. Anything past it shows the whole person too.
+	const unsigned int MISSES = min(static_cast<unsigned int>(max(missCount, 0)), 
+		R::MAX_MISSES);
+	frame += GALLOWS_FRAMES[MISSES * MAX_MISSES / R::MAX_MISSES];
+}
+
+void writeFrame(string& frame)
+{
+	cout.write(frame.data(), static_cast<streamsize>(frame.length()));
+	cout.flush();
+	frame.clear();
+}
+
+int loadCorpus(const string FILE_NAME, Corpus& corpus, const bool REPORT,
+	const string FALLBACK_FILE, const bool CALIBRATE)
+{
+	const auto START = chrono::steady_clock::now();
+
+	//A text file has to be parsed and sorted, a compiled one doesn't.
+	if (!isCompiledCorpus(FILE_NAME))
+	{
+		loadPhrasesFromFile(FILE_NAME, corpus, REPORT);
+		const vector<uint8_t> MISSES = corpus.phraseNum == 0 || !CALIBRATE ? 
+			vector<uint8_t>() : calibrateCorpus(corpus, 
+			filesystem::path(FILE_NAME).replace_extension(".scores").string(), REPORT);
+		corpus.index = sortPhrases(corpus, MISSES.empty() ? nullptr : MISSES.data());
+	}
+	else if (!loadCompiledCorpus(FILE_NAME, corpus))
+	{
+		cout << "Compiled corpus " << FILE_NAME << " is damaged" << endl;
+		corpus.phraseNum = 0;
+
+		//Let go of the damaged file and try the text file instead.
+#ifdef __linux__
+		if (corpus.mapped)
+			munmap(const_cast<char*>(corpus.fileData), corpus.fileSize);
+#endif
+		corpus.fileData = nullptr;
+		corpus.fileSize = 0;
+		corpus.mapped = false;
+		if (!FALLBACK_FILE.empty() && FALLBACK_FILE != FILE_NAME)
+			return loadCorpus(FALLBACK_FILE, corpus, REPORT);
+	}
+	else
+	{
+		if (telemetry().enabled)
+			recordStep(LOAD_COMPILED, START);
+		if (REPORT)
+			cout << "Mapped " << corpus.phraseNum << " phrases from " 
+				<< FILE_NAME << " in " << fixed << setprecision(1) 
+				<< chrono::duration<double, milli>(
+				chrono::steady_clock::now() - START).count() << " ms" << endl;
+	}
+	cout.unsetf(ios::floatfield);
+
+	return corpus.phraseNum;
+}
+
+string pickCorpusFile(const string TEXT_FILE, const string COMPILED_FILE)
+{
+	CorpusHeader header;
+	ifstream compiledIn(COMPILED_FILE, ios::binary);
+	if (!compiledIn.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		memcmp(header.magic, CORPUS_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != CORPUS_VERSION)
+		return TEXT_FILE;
+
+	//Only use the compiled corpus if it came from this text, a file
+	//compiled from anything else or from an older copy doesn't count.
+	uint64_t hash;
+	if (!fileHash(TEXT_FILE, hash))
+		return COMPILED_FILE;
+	return hash == header.sourceHash ? COMPILED_FILE : TEXT_FILE;
+}
+
+bool fileHash(const string FILE_NAME, uint64_t& hash)
+{
+	const size_t CHUNK_SIZE = 1 << 20; //Bytes read from the file at a time
+	vector<char> chunk(CHUNK_SIZE);
+	ifstream fileIn(FILE_NAME, ios::binary);
+	if (fileIn.fail())
+		return false;
+
+	hash = contentHash("");
+	do
+	{
+		fileIn.read(chunk.data(), static_cast<streamsize>(CHUNK_SIZE));
+		hash = contentHash(string_view(chunk.data(), 
+			static_cast<size_t>(fileIn.gcount())), hash);
+	} while (fileIn);
+	return fileIn.eof();
+}
+
+int loadPhrasesFromFile(const string FILE_NAME, Corpus& corpus,
+	const bool REPORT)
+{
+	const size_t CHUNK_SIZE = 1 << 22; //Bytes read from the file at a time
+
+	vector<char>& blob = corpus.textArena; //Holds the whole file
+    ifstream fileIn;
+    
+	//Start the clock for the throughput report
+	const auto START = chrono::steady_clock::now();
+
+    //Open the file
+    fileIn.open(FILE_NAME, ios::binary | ios::ate);
+
+    //what to do if the file doesn't exist.
+    if (fileIn.fail())
+	{
+        cout << "File does not exist" << endl;
+		return 0;
+	}
+
+	//Make room for the whole file up front, then read it a chunk at a time
+	//in case it is bigger than it was.
+	blob.clear();
+	blob.reserve(static_cast<size_t>(max(static_cast<streamoff>(fileIn.tellg()), 
+		streamoff(0))));
+	fileIn.seekg(0);
+	do
+	{
+		const size_t OLD_SIZE = blob.size();
+		blob.resize(OLD_SIZE + CHUNK_SIZE);
+		fileIn.read(blob.data() + OLD_SIZE, CHUNK_SIZE);
+		blob.resize(OLD_SIZE + static_cast<size_t>(fileIn.gcount()));
+	} while (fileIn);
+
+    //Close the file
+    fileIn.close();
+
+	//Pack the phrases together where the file was.
+	const size_t FILE_BYTES = blob.size();
+	splitPhrases(corpus);
+
+	//Report how fast the file was loaded.
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
+	if (telemetry().enabled)
+		recordStep(LOAD_TEXT, START);
+	if (REPORT)
+		cout << "Loaded " << corpus.phraseNum << " phrases (" << fixed 
+		<< setprecision(1) << FILE_BYTES / 1048576.0 << " MB) in " 
+		<< SECONDS * 1000 << " ms, " 
+		<< (SECONDS > 0 ? FILE_BYTES / 1048576.0 / SECONDS : 0) << " MB/s" 
+		<< endl;
+	cout.unsetf(ios::floatfield);
+
+    return corpus.phraseNum;
+}
+
+void splitPhrases(Corpus& corpus)
+{
+	//Most files are plain ASCII and skip straight past this.
+	if (!letterKernels().isAscii(corpus.textArena.data(), corpus.textArena.size()))
+		corpus.textArena.resize(foldUtf8(corpus.textArena.data(), 
+			corpus.textArena.size()));
+
+	const char* begin = corpus.textArena.data();
+	const char* const END = begin + corpus.textArena.size();
+
+	corpus.startArena.assign(1, 0);
+	corpus.maskArena.clear();
+	corpus.countArena.clear();
+
+	//Every newline ends a phrase.
+	while (const char* newline = static_cast<const char*>(
+		memchr(begin, '\n', END - begin)))
+	{
+		addPhrase(begin, newline - begin, corpus);
+		begin = newline + 1;
+	}
+
+	//The last line doesn't need a newline after it.
+	addPhrase(begin, END - begin, corpus);
+
+	//Only the packed text is left. Then count every phrase's letters in
+	//one pass over it.
+	const size_t PHRASE_NUM = corpus.startArena.size() - 1;
+	corpus.textArena.resize(corpus.startArena.back());
+	corpus.maskArena.resize(PHRASE_NUM);
+	letterKernels().letterMasks(corpus.textArena.data(), corpus.startArena.data(),
+		PHRASE_NUM, corpus.maskArena.data());
+	corpus.countArena.resize(PHRASE_NUM);
+	for (size_t phrase = 0; phrase < PHRASE_NUM; phrase++)
+		corpus.countArena[phrase] = static_cast<uint8_t>(
+			uniqueLetterCount(corpus.maskArena[phrase]));
+	useArenas(corpus);
+}
+
+size_t foldUtf8(char* text, const size_t LENGTH)
+{
+	size_t out = 0; //Where the next byte goes, never past where it is read
+
+	for (size_t index = 0; index < LENGTH; )
+	{
+		const unsigned char LEAD = static_cast<unsigned char>(text[index]);
+		const unsigned char NEXT = index + 1 < LENGTH ? 
+			static_cast<unsigned char>(text[index + 1]) : 0;
+		const unsigned int CODE = (LEAD & 0x1F) << 6 | (NEXT & 0x3F);
+
+		//Two byte letters from U+00C0 to U+017F have a plain letter or two.
+		if (LEAD >= 0xC3 && LEAD <= 0xC5 && (NEXT & 0xC0) == 0x80 &&
+			LATIN_FOLDS[(CODE - 0xC0) * 2] != ' ')
+		{
+			text[out++] = LATIN_FOLDS[(CODE - 0xC0) * 2];
+			if (LATIN_FOLDS[(CODE - 0xC0) * 2 + 1] != ' ')
+				text[out++] = LATIN_FOLDS[(CODE - 0xC0) * 2 + 1];
+			index += 2;
+		}
+
+		//Combining accents, U+0300 to U+036F, go with the letter before.
+		else if ((LEAD == 0xCC || (LEAD == 0xCD && NEXT < 0xB0)) && 
+			(NEXT & 0xC0) == 0x80)
+			index += 2;
+
+		//So does a byte order mark.
+		else if (LEAD == 0xEF && NEXT == 0xBB && index + 2 < LENGTH &&
+			static_cast<unsigned char>(text[index + 2]) == 0xBF)
+			index += 3;
+
+		else
+			text[out++] = text[index++];
+	}
+	return out;
+}
+
+void addPhrase(const char* LINE, size_t length, Corpus& corpus)
+{
+	//Drop the carriage return from Windows line endings.
+	if (length > 0 && LINE[length - 1] == '\r')
+		length--;
+
+	//Empty lines aren't phrases.
+	if (length == 0)
+		return;
+
+	//Move the text right after the last phrase's.
+	memmove(corpus.textArena.data() + corpus.startArena.back(), LINE, length);
+	corpus.startArena.push_back(corpus.startArena.back() + length);
+}
+
+void useArenas(Corpus& corpus)
+{
+	corpus.phraseNum = static_cast<int>(corpus.maskArena.size());
+	corpus.text = corpus.textArena.data();
+	corpus.starts = corpus.startArena.data();
+	corpus.masks = corpus.maskArena.data();
+	corpus.counts = corpus.countArena.data();
+}
+
+string_view phraseText(const Corpus& CORPUS, const int PHRASE)
+{
+	return string_view(CORPUS.text + CORPUS.starts[PHRASE], 
+		CORPUS.starts[PHRASE + 1] - CORPUS.starts[PHRASE]);
+}
+
+
+bool compileCorpus(const string IN_FILE, const string OUT_FILE, const bool CALIBRATE)
+{
+	Corpus corpus;
+	uint64_t sourceHash;
+	const int PHRASE_NUM = loadCorpus(IN_FILE, corpus, true, "", CALIBRATE);
+	if (PHRASE_NUM == 0 || !fileHash(IN_FILE, sourceHash))
+		return false;
+
+	//Lay the sections out one after another, each on a multiple of 8.
+	auto roundUp = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+	CorpusHeader header = {};
+	memcpy(header.magic, CORPUS_MAGIC, sizeof(header.magic));
+	header.version = CORPUS_VERSION;
+	header.phraseNum = static_cast<uint32_t>(PHRASE_NUM);
+	header.textOffset = roundUp(sizeof(CorpusHeader));
+	header.textBytes = corpus.starts[PHRASE_NUM];
+	header.startsOffset = roundUp(header.textOffset + header.textBytes);
+	header.masksOffset = roundUp(header.startsOffset + 
+		(header.phraseNum + 1ull) * sizeof(uint64_t));
+	header.countsOffset = roundUp(header.masksOffset + 
+		header.phraseNum * sizeof(uint32_t));
+	header.orderOffset = roundUp(header.countsOffset + header.phraseNum);
+	copy(begin(corpus.index.bucketStart), end(corpus.index.bucketStart), 
+		header.bucketStart);
+	copy(begin(corpus.index.tierStart), end(corpus.index.tierStart), 
+		header.tierStart);
+	header.scored = CALIBRATE ? 1 : 0;
+	header.sourceHash = sourceHash;
+
+	//The arrays are written as they are, only the order changes type.
+	vector<int32_t> order(corpus.index.order.begin(), corpus.index.order.end());
+
+	//Write a copy and rename it over the old file at the end, so a server
+	//with the old one mapped keeps it and never sees half a file.
+	const string TEMP_FILE = OUT_FILE + ".tmp";
+	ofstream fileOut(TEMP_FILE, ios::binary);
+	if (fileOut.fail())
+	{
+		cout << "Can't write " << OUT_FILE << endl;
+		return false;
+	}
+
+	//Pads the file out to where the next section starts.
+	auto padTo = [&fileOut](const uint64_t OFFSET)
+	{
+		while (static_cast<uint64_t>(fileOut.tellp()) < OFFSET)
+			fileOut.put('\0');
+	};
+
+	fileOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	padTo(header.textOffset);
+	fileOut.write(corpus.text, static_cast<streamsize>(header.textBytes));
+	padTo(header.startsOffset);
+	fileOut.write(reinterpret_cast<const char*>(corpus.starts), 
+		(PHRASE_NUM + 1) * sizeof(uint64_t));
+	padTo(header.masksOffset);
+	fileOut.write(reinterpret_cast<const char*>(corpus.masks), 
+		PHRASE_NUM * sizeof(uint32_t));
+	padTo(header.countsOffset);
+	fileOut.write(reinterpret_cast<const char*>(corpus.counts), PHRASE_NUM);
+	padTo(header.orderOffset);
+	fileOut.write(reinterpret_cast<const char*>(order.data()), 
+		order.size() * sizeof(int32_t));
+	fileOut.close();
+
+	error_code error;
+	if (!fileOut.fail())
+		filesystem::rename(TEMP_FILE, OUT_FILE, error);
+	if (fileOut.fail() || error)
+	{
+		filesystem::remove(TEMP_FILE, error);
+		cout << "Can't write " << OUT_FILE << endl;
+		return false;
+	}
+
+	cout << "Compiled " << PHRASE_NUM << " phrases to " << OUT_FILE << endl;
+
+	//Scores follow the order, so each level's are its first and last phrase's.
+	const char* const LEVEL_NAMES[INVALID_DIFFICULTY] = {"Easy", "Medium", "Hard"};
+	for (int diff = EASY; CALIBRATE && diff < INVALID_DIFFICULTY; diff++)
+	{
+		const int FIRST = corpus.index.tierStart[diff];
+		const int LAST = corpus.index.tierStart[diff + 1] - 1;
+		if (FIRST <= LAST)
+			cout << LEVEL_NAMES[diff] << ": " 
+				<< static_cast<int>(scorePhrase(corpus.masks[corpus.index.order[FIRST]])) 
+				<< " to " 
+				<< static_cast<int>(scorePhrase(corpus.masks[corpus.index.order[LAST]])) 
+				<< " misses" << endl;
+	}
+	return true;
+}
+
+bool loadCompiledCorpus(const string FILE_NAME, Corpus& corpus)
+{
+#ifdef __linux__
+	//Map the file so nothing is read until it is used, and every
+	//process playing the same corpus shares the same pages.
+	const int FD = open(FILE_NAME.c_str(), O_RDONLY);
+	struct stat info;
+	if (FD < 0 || fstat(FD, &info) != 0 || info.st_size == 0)
+	{
+		if (FD >= 0)
+			close(FD);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, 
+		MAP_PRIVATE, FD, 0);
+	close(FD);
+	if (data == MAP_FAILED)
+		return false;
+	corpus.fileData = static_cast<const char*>(data);
+	corpus.fileSize = static_cast<size_t>(info.st_size);
+	corpus.mapped = true;
+#else
+	//Without mmap the file is read in whole.
+	ifstream fileIn(FILE_NAME, ios::binary | ios::ate);
+	if (fileIn.fail())
+		return false;
+	corpus.textArena.resize(static_cast<size_t>(fileIn.tellg()));
+	fileIn.seekg(0);
+	fileIn.read(corpus.textArena.data(), corpus.textArena.size());
+	corpus.fileData = corpus.textArena.data();
+	corpus.fileSize = corpus.textArena.size();
+#endif
+
+	//Check that every section is inside the file before using any of it.
+	CorpusHeader header;
+	if (corpus.fileSize < sizeof(header))
+		return false;
+	memcpy(&header, corpus.fileData, sizeof(header));
+	const uint64_t SIZE = corpus.fileSize;
+	const uint64_t PHRASE_NUM = header.phraseNum;
+	if (memcmp(header.magic, CORPUS_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != CORPUS_VERSION ||
+		header.textOffset > SIZE || header.textBytes > SIZE - header.textOffset ||
+		header.startsOffset > SIZE || 
+		(SIZE - header.startsOffset) / sizeof(uint64_t) < PHRASE_NUM + 1 ||
+		header.masksOffset > SIZE || 
+		(SIZE - header.masksOffset) / sizeof(uint32_t) < PHRASE_NUM ||
+		header.countsOffset > SIZE || SIZE - header.countsOffset < PHRASE_NUM ||
+		header.orderOffset > SIZE || 
+		(SIZE - header.orderOffset) / sizeof(int32_t) < PHRASE_NUM ||
+		(header.startsOffset | header.masksOffset | header.orderOffset) % 8 != 0 ||
+		PHRASE_NUM > static_cast<uint64_t>(INT32_MAX) || header.scored > 1)
+		return false;
+
+	//The levels have to be the thirds sortPhrases splits the order into.
+	const int32_t THIRD = static_cast<int32_t>(PHRASE_NUM / 3);
+	if (header.tierStart[EASY] != 0 || header.tierStart[MEDIUM] != THIRD ||
+		header.tierStart[HARD] != THIRD * 2 ||
+		header.tierStart[INVALID_DIFFICULTY] != static_cast<int32_t>(PHRASE_NUM))
+		return false;
+
+	//Use the arrays right where they are in the file, nothing is parsed or
+	//counted again.
+	const uint64_t* const STARTS = reinterpret_cast<const uint64_t*>(
+		corpus.fileData + header.startsOffset);
+	const uint32_t* const MASKS = reinterpret_cast<const uint32_t*>(
+		corpus.fileData + header.masksOffset);
+	const uint8_t* const COUNTS = reinterpret_cast<const uint8_t*>(
+		corpus.fileData + header.countsOffset);
+	const int32_t* const ORDER = reinterpret_cast<const int32_t*>(
+		corpus.fileData + header.orderOffset);
+	if (STARTS[0] != 0 || STARTS[PHRASE_NUM] != header.textBytes)
+		return false;
+
+	//Every phrase has to have some text inside the text section, only
+	//letters in its mask, and as many guesses required as letters.
+	for (uint64_t phrase = 0; phrase < PHRASE_NUM; phrase++)
+		if (STARTS[phrase] >= STARTS[phrase + 1] || (MASKS[phrase] >> 26) != 0 ||
+			COUNTS[phrase] != uniqueLetterCount(MASKS[phrase]))
+			return false;
+
+	//The order has to hold every phrase once, sorted the same way
+	//sortPhrases sorts them. It is copied out as it is checked.
+	vector<uint64_t> seen((PHRASE_NUM + 63) / 64, 0); //Phrases already in the order
+	int32_t bucketSize[27] = {0}; //Phrases in each bucket
+	int lastKey = 0; //Sort key of the phrase before
+	corpus.index.order.resize(PHRASE_NUM);
+	for (uint64_t slot = 0; slot < PHRASE_NUM; slot++)
+	{
+		const int32_t PHRASE = ORDER[slot];
+		if (PHRASE < 0 || static_cast<uint64_t>(PHRASE) >= PHRASE_NUM || 
+			(seen[PHRASE / 64] >> (PHRASE % 64) & 1) != 0)
+			return false;
+		seen[PHRASE / 64] |= uint64_t(1) << (PHRASE % 64);
+
+		const int BUCKET = header.scored ? scorePhrase(MASKS[PHRASE]) : COUNTS[PHRASE];
+		const int KEY = (header.scored ? BUCKET * 27 : 0) + COUNTS[PHRASE];
+		if (KEY < lastKey)
+			return false;
+		lastKey = KEY;
+		bucketSize[BUCKET]++;
+		corpus.index.order[slot] = PHRASE;
+	}
+
+	//Each bucket has to start right after the ones before it.
+	int32_t bucketStart = 0;
+	for (int bucket = 0; bucket < 28; bucket++)
+	{
+		if (header.bucketStart[bucket] != bucketStart)
+			return false;
+		if (bucket < 27)
+			bucketStart += bucketSize[bucket];
+	}
+
+	corpus.phraseNum = static_cast<int>(PHRASE_NUM);
+	corpus.text = corpus.fileData + header.textOffset;
+	corpus.starts = STARTS;
+	corpus.masks = MASKS;
+	corpus.counts = COUNTS;
+	copy(begin(header.bucketStart), end(header.bucketStart), 
+		corpus.index.bucketStart);
+	copy(begin(header.tierStart), end(header.tierStart), corpus.index.tierStart);
+
+	return true;
+}
+
+bool isCompiledCorpus(const string FILE_NAME)
+{
+	char magic[sizeof(CORPUS_MAGIC)] = {0};
+	ifstream fileIn(FILE_NAME, ios::binary);
+	fileIn.read(magic, sizeof(magic));
+	return memcmp(magic, CORPUS_MAGIC, sizeof(magic)) == 0;
+}
+
+Corpus::~Corpus()
+{
+#ifdef __linux__
+	if (mapped)
+		munmap(const_cast<char*>(fileData), fileSize);
+#endif
+}
+
+unsigned int letterBit(char ch)
+{
+	return CHAR_TABLE.bit[static_cast<unsigned char>(ch)];
+}
+
+unsigned int buildLetterMask(const string_view SINGLE_PHRASE)
+{
+	return letterKernels().letterMask(SINGLE_PHRASE.data(), SINGLE_PHRASE.length());
+}
+
+const LetterKernels& letterKernels()
+{
+	static const LetterKernels KERNELS = []
+	{
+		const char* const CHOICE = getenv("HANGMAN_SIMD");
+		const string WANTED = CHOICE ? CHOICE : "";
+		LetterKernels kernels = {"scalar", scalarLetterMask, scalarRenderBlanks,
+			scalarMatchesPattern, scalarIsAscii, scalarLetterMasks};
+#if defined(__x86_64__) && defined(__GNUC__)
+		if (WANTED == "scalar")
+			return kernels;
+		kernels = {"sse2", sse2LetterMask, sse2RenderBlanks, sse2MatchesPattern,
+			sse2IsAscii, sse2LetterMasks};
+		if (WANTED != "sse2" && __builtin_cpu_supports("avx2"))
+			kernels = {"avx2", avx2LetterMask, avx2RenderBlanks, avx2MatchesPattern,
+				avx2IsAscii, avx2LetterMasks};
+#endif
+		return kernels;
+	}();
+	return KERNELS;
+}
+
+unsigned int scalarLetterMask(const char* TEXT, const size_t LENGTH)
+{
+	unsigned int mask = 0; //Holds the letters seen so far
+
+	//Add the bit for every character, non-letters add nothing.
+	for (size_t index = 0; index < LENGTH; index++)
+		mask |= letterBit(TEXT[index]);
+
+	return mask;
+}
+
+void scalarRenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out)
+{
+	for (size_t index = 0; index < LENGTH; index++)
+	{
+		const unsigned int BIT = letterBit(TEXT[index]);
+		out[index * 2] = BIT != 0 && (SHOWN_MASK & BIT) ? TEXT[index] : 
+			withoutGuesses(TEXT[index]);
+		out[index * 2 + 1] = ' ';
+	}
+}
+
+bool scalarMatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK)
+{
+	for (size_t index = 0; index < LENGTH; index++)
+	{
+		const char SHOWN = BLANK_PHRASE[index * 2];
+
+		//A blank can only hide a letter that hasn't been guessed.
+		if (SHOWN == '_')
+		{
+			if (!maybeUnique(GUESSED_MASK, TEXT[index]))
+				return false;
+		}
+		//Anything shown has to be the same letter or punctuation.
+		else if (toLower(SHOWN) != toLower(TEXT[index]))
+			return false;
+	}
+	return true;
+}
+
+bool scalarIsAscii(const char* TEXT, const size_t LENGTH)
+{
+	uint64_t bits = 0; //Every byte ORed together, 8 at a time
+	size_t index = 0;
+
+	for (; index + 8 <= LENGTH; index += 8)
+	{
+		uint64_t word;
+		memcpy(&word, TEXT + index, sizeof(word));
+		bits |= word;
+	}
+	for (; index < LENGTH; index++)
+		bits |= static_cast<unsigned char>(TEXT[index]);
+
+	return (bits & 0x8080808080808080ull) == 0;
+}
+
+void scalarLetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks)
+{
+	for (size_t phrase = 0; phrase < COUNT; phrase++)
+		masks[phrase] = scalarLetterMask(TEXT + STARTS[phrase],
+			STARTS[phrase + 1] - STARTS[phrase]);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+void sse2Classify(const __m128i CHARS, __m128i& isLetter, __m128i& bit, 
+	__m128i& group)
+{
+	//'a' to 'z' and 'A' to 'Z' become 0 to 25, everything else is more.
+	const __m128i INDEX = _mm_sub_epi8(_mm_or_si128(CHARS, _mm_set1_epi8(0x20)),
+		_mm_set1_epi8('a'));
+	isLetter = _mm_cmpeq_epi8(_mm_min_epu8(INDEX, _mm_set1_epi8(25)), INDEX);
+	group = _mm_and_si128(INDEX, _mm_set1_epi8(0x18));
+
+	//1 << (INDEX & 7), doubling, then times 4, then times 16 where that
+	//bit of the shift is set. No byte gets past 128 so none spill over.
+	const __m128i LOW = _mm_and_si128(INDEX, _mm_set1_epi8(7));
+	__m128i shift = _mm_set1_epi8(1);
+	__m128i where = _mm_cmpeq_epi8(_mm_and_si128(LOW, _mm_set1_epi8(1)), 
+		_mm_set1_epi8(1));
+	shift = _mm_add_epi8(shift, _mm_and_si128(shift, where));
+	where = _mm_cmpeq_epi8(_mm_and_si128(LOW, _mm_set1_epi8(2)), _mm_set1_epi8(2));
+	shift = _mm_or_si128(_mm_andnot_si128(where, shift), 
+		_mm_and_si128(where, _mm_slli_epi16(shift, 2)));
+	where = _mm_cmpeq_epi8(_mm_and_si128(LOW, _mm_set1_epi8(4)), _mm_set1_epi8(4));
+	shift = _mm_or_si128(_mm_andnot_si128(where, shift), 
+		_mm_and_si128(where, _mm_slli_epi16(shift, 4)));
+	bit = _mm_and_si128(shift, isLetter);
+}
+
+void sse2InMask(const __m128i IS_LETTER, const __m128i BIT, 
+	const __m128i GROUP, const __m128i MASK_BYTES[4], __m128i& inMask)
+{
+	//Pick the byte of the mask each letter's bit is in.
+	__m128i maskByte = _mm_setzero_si128();
+	for (int group = 0; group < 4; group++)
+		maskByte = _mm_or_si128(maskByte, _mm_and_si128(MASK_BYTES[group], 
+			_mm_cmpeq_epi8(GROUP, _mm_set1_epi8(static_cast<char>(group * 8)))));
+
+	inMask = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(maskByte, BIT), 
+		_mm_setzero_si128()), IS_LETTER);
+}
+
+unsigned int sse2LetterMask(const char* TEXT, const size_t LENGTH)
+{
+	__m128i found[4] = {_mm_setzero_si128(), _mm_setzero_si128(), 
+		_mm_setzero_si128(), _mm_setzero_si128()}; //Bits seen for each byte
+	alignas(16) char last[16]; //The end of the text, padded with zeros
+
+	for (size_t index = 0; index < LENGTH; index += 16)
+	{
+		__m128i chars;
+		if (LENGTH - index >= 16)
+			chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(TEXT + index));
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, LENGTH - index);
+			chars = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+		}
+
+		__m128i isLetter, bit, group;
+		sse2Classify(chars, isLetter, bit, group);
+		for (int byte = 0; byte < 4; byte++)
+			found[byte] = _mm_or_si128(found[byte], _mm_and_si128(bit, 
+				_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(byte * 8)))));
+	}
+
+	//Fold each byte's bits down to one byte of the mask.
+	unsigned int mask = 0;
+	for (int byte = 0; byte < 4; byte++)
+	{
+		__m128i bits = found[byte];
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 8));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 4));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 2));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 1));
+		mask |= (static_cast<unsigned int>(_mm_cvtsi128_si32(bits)) & 0xFF) << (byte * 8);
+	}
+	return mask;
+}
+
+void sse2RenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out)
+{
+	const __m128i SHOWN[4] = {_mm_set1_epi8(static_cast<char>(SHOWN_MASK)),
+		_mm_set1_epi8(static_cast<char>(SHOWN_MASK >> 8)),
+		_mm_set1_epi8(static_cast<char>(SHOWN_MASK >> 16)),
+		_mm_set1_epi8(static_cast<char>(SHOWN_MASK >> 24))};
+	alignas(16) char last[16]; //The end of the text, padded with zeros
+	alignas(16) char lastOut[32]; //The end of the output before it's copied
+
+	for (size_t index = 0; index < LENGTH; index += 16)
+	{
+		const bool WHOLE = LENGTH - index >= 16;
+		__m128i chars;
+		if (WHOLE)
+			chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(TEXT + index));
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, LENGTH - index);
+			chars = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+		}
+
+		__m128i isLetter, bit, group, inMask;
+		sse2Classify(chars, isLetter, bit, group);
+		sse2InMask(isLetter, bit, group, SHOWN, inMask);
+
+		//Only letters that haven't been shown are blanks, like CHAR_TABLE.
+		const __m128i SHOW = _mm_or_si128(inMask, 
+			_mm_andnot_si128(isLetter, _mm_set1_epi8(-1)));
+		const __m128i SHOWN_CHARS = _mm_or_si128(_mm_and_si128(SHOW, chars), 
+			_mm_andnot_si128(SHOW, _mm_set1_epi8('_')));
+
+		//Put a space after every character.
+		char* const TO = WHOLE ? out + index * 2 : lastOut;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(TO), 
+			_mm_unpacklo_epi8(SHOWN_CHARS, _mm_set1_epi8(' ')));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(TO + 16), 
+			_mm_unpackhi_epi8(SHOWN_CHARS, _mm_set1_epi8(' ')));
+		if (!WHOLE)
+			memcpy(out + index * 2, lastOut, (LENGTH - index) * 2);
+	}
+}
+
+bool sse2MatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK)
+{
+	const __m128i GUESSED[4] = {_mm_set1_epi8(static_cast<char>(GUESSED_MASK)),
+		_mm_set1_epi8(static_cast<char>(GUESSED_MASK >> 8)),
+		_mm_set1_epi8(static_cast<char>(GUESSED_MASK >> 16)),
+		_mm_set1_epi8(static_cast<char>(GUESSED_MASK >> 24))};
+	alignas(16) char last[16]; //The end of the text, padded with zeros
+	alignas(16) char lastBlank[32]; //The end of the phrase with blanks
+
+	for (size_t index = 0; index < LENGTH; index += 16)
+	{
+		const size_t COUNT = min(LENGTH - index, size_t(16));
+		__m128i chars, blank[2];
+		if (COUNT == 16 && index * 2 + 32 <= LENGTH * 2 - 1)
+		{
+			chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(TEXT + index));
+			blank[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+				BLANK_PHRASE + index * 2));
+			blank[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+				BLANK_PHRASE + index * 2 + 16));
+		}
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, COUNT);
+			memset(lastBlank, 0, sizeof(lastBlank));
+			memcpy(lastBlank, BLANK_PHRASE + index * 2, COUNT * 2 - 1);
+			chars = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+			blank[0] = _mm_load_si128(reinterpret_cast<const __m128i*>(lastBlank));
+			blank[1] = _mm_load_si128(reinterpret_cast<const __m128i*>(lastBlank + 16));
+		}
+
+		//Drop the spaces between the characters of the phrase with blanks.
+		const __m128i SHOWN = _mm_packus_epi16(
+			_mm_and_si128(blank[0], _mm_set1_epi16(0xFF)),
+			_mm_and_si128(blank[1], _mm_set1_epi16(0xFF)));
+
+		__m128i isLetter, bit, group, inMask;
+		sse2Classify(chars, isLetter, bit, group);
+		sse2InMask(isLetter, bit, group, GUESSED, inMask);
+
+		//A blank needs an unguessed letter, anything else the same character.
+		const __m128i IS_BLANK = _mm_cmpeq_epi8(SHOWN, _mm_set1_epi8('_'));
+		const __m128i BLANK_FITS = _mm_andnot_si128(inMask, isLetter);
+
+		//Make the capital letters lowercase on both sides before comparing.
+		__m128i folded[2] = {SHOWN, chars};
+		for (int side = 0; side < 2; side++)
+		{
+			const __m128i FROM_A = _mm_sub_epi8(folded[side], _mm_set1_epi8('A'));
+			folded[side] = _mm_or_si128(folded[side], _mm_and_si128(_mm_set1_epi8(0x20),
+				_mm_cmpeq_epi8(_mm_min_epu8(FROM_A, _mm_set1_epi8(25)), FROM_A)));
+		}
+		const __m128i SHOWN_FITS = _mm_cmpeq_epi8(folded[0], folded[1]);
+		const __m128i FITS = _mm_or_si128(_mm_and_si128(IS_BLANK, BLANK_FITS),
+			_mm_andnot_si128(IS_BLANK, SHOWN_FITS));
+
+		const int USED = (1 << COUNT) - 1; //Lanes that hold the phrase
+		if ((_mm_movemask_epi8(FITS) & USED) != USED)
+			return false;
+	}
+	return true;
+}
+
+bool sse2IsAscii(const char* TEXT, const size_t LENGTH)
+{
+	__m128i bits = _mm_setzero_si128(); //Every block ORed together
+	size_t index = 0;
+
+	for (; index + 16 <= LENGTH; index += 16)
+		bits = _mm_or_si128(bits, _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(TEXT + index)));
+
+	return _mm_movemask_epi8(bits) == 0 && scalarIsAscii(TEXT + index, LENGTH - index);
+}
+
+void sse2LetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks)
+{
+	//The kernel is called directly, so it can be inlined into the loop.
+	for (size_t phrase = 0; phrase < COUNT; phrase++)
+		masks[phrase] = sse2LetterMask(TEXT + STARTS[phrase],
+			STARTS[phrase + 1] - STARTS[phrase]);
+}
+
+__attribute__((target("avx2"))) 
+void avx2Classify(const __m256i CHARS, __m256i& isLetter, __m256i& bit, 
+	__m256i& group)
+{
+	//'a' to 'z' and 'A' to 'Z' become 0 to 25, everything else is more.
+	const __m256i INDEX = _mm256_sub_epi8(_mm256_or_si256(CHARS, 
+		_mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(INDEX, _mm256_set1_epi8(25)), INDEX);
+	group = _mm256_and_si256(INDEX, _mm256_set1_epi8(0x18));
+
+	//1 << (INDEX & 7) looked up from a table.
+	const __m256i BITS = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 
+		0, 0, 0, 0, 0, 0, 0, 0);
+	bit = _mm256_and_si256(_mm256_shuffle_epi8(BITS, 
+		_mm256_and_si256(INDEX, _mm256_set1_epi8(7))), isLetter);
+}
+
+__attribute__((target("avx2"))) 
+void avx2InMask(const __m256i IS_LETTER, const __m256i BIT, 
+	const __m256i GROUP, const __m256i MASK_BYTES[4], __m256i& inMask)
+{
+	//Pick the byte of the mask each letter's bit is in.
+	__m256i maskByte = _mm256_setzero_si256();
+	for (int group = 0; group < 4; group++)
+		maskByte = _mm256_or_si256(maskByte, _mm256_and_si256(MASK_BYTES[group], 
+			_mm256_cmpeq_epi8(GROUP, _mm256_set1_epi8(static_cast<char>(group * 8)))));
+
+	inMask = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(maskByte, BIT),
+		_mm256_setzero_si256()), IS_LETTER);
+}
+
+__attribute__((target("avx2"))) 
+unsigned int avx2LetterMask(const char* TEXT, const size_t LENGTH)
+{
+	__m256i found[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), 
+		_mm256_setzero_si256(), _mm256_setzero_si256()}; //Bits seen for each byte
+	alignas(32) char last[32]; //The end of the text, padded with zeros
+
+	for (size_t index = 0; index < LENGTH; index += 32)
+	{
+		__m256i chars;
+		if (LENGTH - index >= 32)
+			chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(TEXT + index));
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, LENGTH - index);
+			chars = _mm256_load_si256(reinterpret_cast<const __m256i*>(last));
+		}
+
+		__m256i isLetter, bit, group;
+		avx2Classify(chars, isLetter, bit, group);
+		for (int byte = 0; byte < 4; byte++)
+			found[byte] = _mm256_or_si256(found[byte], _mm256_and_si256(bit, 
+				_mm256_cmpeq_epi8(group, _mm256_set1_epi8(static_cast<char>(byte * 8)))));
+	}
+
+	//Fold each byte's bits down to one byte of the mask.
+	unsigned int mask = 0;
+	for (int byte = 0; byte < 4; byte++)
+	{
+		__m128i bits = _mm_or_si128(_mm256_castsi256_si128(found[byte]),
+			_mm256_extracti128_si256(found[byte], 1));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 8));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 4));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 2));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 1));
+		mask |= (static_cast<unsigned int>(_mm_cvtsi128_si32(bits)) & 0xFF) << (byte * 8);
+	}
+	return mask;
+}
+
+__attribute__((target("avx2"))) 
+void avx2RenderBlanks(const char* TEXT, const size_t LENGTH,
+	const unsigned int SHOWN_MASK, char* out)
+{
+	const __m256i SHOWN[4] = {_mm256_set1_epi8(static_cast<char>(SHOWN_MASK)),
+		_mm256_set1_epi8(static_cast<char>(SHOWN_MASK >> 8)),
+		_mm256_set1_epi8(static_cast<char>(SHOWN_MASK >> 16)),
+		_mm256_set1_epi8(static_cast<char>(SHOWN_MASK >> 24))};
+	alignas(32) char last[32]; //The end of the text, padded with zeros
+	alignas(32) char lastOut[64]; //The end of the output before it's copied
+
+	for (size_t index = 0; index < LENGTH; index += 32)
+	{
+		const bool WHOLE = LENGTH - index >= 32;
+		__m256i chars;
+		if (WHOLE)
+			chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(TEXT + index));
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, LENGTH - index);
+			chars = _mm256_load_si256(reinterpret_cast<const __m256i*>(last));
+		}
+
+		__m256i isLetter, bit, group, inMask;
+		avx2Classify(chars, isLetter, bit, group);
+		avx2InMask(isLetter, bit, group, SHOWN, inMask);
+
+		//Only letters that haven't been shown are blanks, like CHAR_TABLE.
+		const __m256i SHOWN_CHARS = _mm256_blendv_epi8(chars, _mm256_set1_epi8('_'), 
+			_mm256_andnot_si256(inMask, isLetter));
+
+		//Put a space after every character. Unpacking works within each
+		//half, so the halves are put back in order after.
+		const __m256i LOW = _mm256_unpacklo_epi8(SHOWN_CHARS, _mm256_set1_epi8(' '));
+		const __m256i HIGH = _mm256_unpackhi_epi8(SHOWN_CHARS, _mm256_set1_epi8(' '));
+		char* const TO = WHOLE ? out + index * 2 : lastOut;
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(TO), 
+			_mm256_permute2x128_si256(LOW, HIGH, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(TO + 32), 
+			_mm256_permute2x128_si256(LOW, HIGH, 0x31));
+		if (!WHOLE)
+			memcpy(out + index * 2, lastOut, (LENGTH - index) * 2);
+	}
+}
+
+__attribute__((target("avx2"))) 
+bool avx2MatchesPattern(const char* TEXT, const size_t LENGTH,
+	const char* BLANK_PHRASE, const unsigned int GUESSED_MASK)
+{
+	const __m256i GUESSED[4] = {_mm256_set1_epi8(static_cast<char>(GUESSED_MASK)),
+		_mm256_set1_epi8(static_cast<char>(GUESSED_MASK >> 8)),
+		_mm256_set1_epi8(static_cast<char>(GUESSED_MASK >> 16)),
+		_mm256_set1_epi8(static_cast<char>(GUESSED_MASK >> 24))};
+	alignas(32) char last[32]; //The end of the text, padded with zeros
+	alignas(32) char lastBlank[64]; //The end of the phrase with blanks
+
+	for (size_t index = 0; index < LENGTH; index += 32)
+	{
+		const size_t COUNT = min(LENGTH - index, size_t(32));
+		__m256i chars, blank[2];
+		if (COUNT == 32 && index * 2 + 64 <= LENGTH * 2 - 1)
+		{
+			chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(TEXT + index));
+			blank[0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+				BLANK_PHRASE + index * 2));
+			blank[1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+				BLANK_PHRASE + index * 2 + 32));
+		}
+		else
+		{
+			memset(last, 0, sizeof(last));
+			memcpy(last, TEXT + index, COUNT);
+			memset(lastBlank, 0, sizeof(lastBlank));
+			memcpy(lastBlank, BLANK_PHRASE + index * 2, COUNT * 2 - 1);
+			chars = _mm256_load_si256(reinterpret_cast<const __m256i*>(last));
+			blank[0] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lastBlank));
+			blank[1] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lastBlank + 32));
+		}
+
+		//Drop the spaces between the characters of the phrase with blanks.
+		//Packing works within each half, so the quarters are put back in
+		//order after.
+		const __m256i SHOWN = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+			_mm256_and_si256(blank[0], _mm256_set1_epi16(0xFF)),
+			_mm256_and_si256(blank[1], _mm256_set1_epi16(0xFF))), 0xD8);
+
+		__m256i isLetter, bit, group, inMask;
+		avx2Classify(chars, isLetter, bit, group);
+		avx2InMask(isLetter, bit, group, GUESSED, inMask);
+
+		//A blank needs an unguessed letter, anything else the same character.
+		const __m256i IS_BLANK = _mm256_cmpeq_epi8(SHOWN, _mm256_set1_epi8('_'));
+		const __m256i BLANK_FITS = _mm256_andnot_si256(inMask, isLetter);
+
+		//Make the capital letters lowercase on both sides before comparing.
+		__m256i folded[2] = {SHOWN, chars};
+		for (int side = 0; side < 2; side++)
+		{
+			const __m256i FROM_A = _mm256_sub_epi8(folded[side], _mm256_set1_epi8('A'));
+			folded[side] = _mm256_or_si256(folded[side], _mm256_and_si256(
+				_mm256_set1_epi8(0x20), _mm256_cmpeq_epi8(_mm256_min_epu8(FROM_A, 
+				_mm256_set1_epi8(25)), FROM_A)));
+		}
+		const __m256i SHOWN_FITS = _mm256_cmpeq_epi8(folded[0], folded[1]);
+		const __m256i FITS = _mm256_blendv_epi8(SHOWN_FITS, BLANK_FITS, IS_BLANK);
+
+		//Lanes that hold the phrase
+		const uint32_t USED = COUNT == 32 ? ~0u : (1u << COUNT) - 1;
+		if ((static_cast<uint32_t>(_mm256_movemask_epi8(FITS)) & USED) != USED)
+			return false;
+	}
+	return true;
+}
+
+__attribute__((target("avx2")))
+bool avx2IsAscii(const char* TEXT, const size_t LENGTH)
+{
+	__m256i bits = _mm256_setzero_si256(); //Every block ORed together
+	size_t index = 0;
+
+	for (; index + 32 <= LENGTH; index += 32)
+		bits = _mm256_or_si256(bits, _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(TEXT + index)));
+
+	return _mm256_movemask_epi8(bits) == 0 && scalarIsAscii(TEXT + index, LENGTH - index);
+}
+
+__attribute__((target("avx2")))
+void avx2LetterMasks(const char* TEXT, const uint64_t* STARTS, const size_t COUNT,
+	uint32_t* masks)
+{
+	for (size_t phrase = 0; phrase < COUNT; phrase++)
+		masks[phrase] = avx2LetterMask(TEXT + STARTS[phrase],
+			STARTS[phrase + 1] - STARTS[phrase]);
+}
+#endif
+
+bool maybeUnique(const unsigned int UNIQ_MASK, char ch)
+{
+	const unsigned int BIT = letterBit(ch);
+
+	//It has to be a letter, and not one that is already in the mask.
+	return BIT != 0 && (UNIQ_MASK & BIT) == 0;
+}
+
+int uniqueLetterCount(const unsigned int LETTER_MASK)
+{
+	//Every set bit is one unique letter.
+	return static_cast<int>(bitset<26>(LETTER_MASK).count());
+}
+
+//PASSED, DON'T TOUCH
+void printPhrases(const Corpus& CORPUS, const PhrasePool& POOL)
+{
+	string strUse; //Holds the value for t/f in IS_USED
+
+	//Display the header
+	cout << setw(3) << right << "#" << " " << setw(49) << left 
+        << "Phrase" << setw(5) << left << "State" << endl;
+	
+    //Display the guesses required, text, and whether or not it is used.
+	for (int index = 0; index < CORPUS.phraseNum; index++)
+	{
+		if (isUsed(POOL, index))
+			strUse = "used";
+		else 
+			strUse = "unused";
+
+		cout << setw(3) << right << static_cast<int>(CORPUS.counts[index]) << " " 
+			<< setw(49) << left << phraseText(CORPUS, index) 
+			<< setw(4) << strUse << endl;
+	}
+}
+
+DifficultyIndex sortPhrases(const Corpus& CORPUS, const uint8_t* MISSES)
+{
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	const auto START = chrono::steady_clock::now();
+	const int KEYS = 27 * 27; //Every misses and guesses pair
+	DifficultyIndex index;
+	int keyStart[KEYS + 1] = {0}; //Where phrases with each key start
+	int next[KEYS]; //Where the next phrase with each key goes
+
+	//Misses count for more than any number of guesses.
+	auto keyOf = [&](const int PHRASE)
+	{
+		return (MISSES ? min<int>(MISSES[PHRASE], 26) * 27 : 0) + CORPUS.counts[PHRASE];
+	};
+
+	//Count how many phrases have each key.
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		keyStart[keyOf(phrase) + 1]++;
+
+	//Add up the counts so each key starts where the last one ends.
+	for (int key = 0; key < KEYS; key++)
+	{
+		keyStart[key + 1] += keyStart[key];
+		next[key] = keyStart[key];
+	}
+
+	//Place every phrase index in its bucket, keeping file order within it.
+	index.order.resize(PHRASE_NUM);
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		index.order[next[keyOf(phrase)]++] = phrase;
+
+	//Buckets are by misses when there are scores, guesses when there aren't.
+	for (int bucket = 0; bucket < 28; bucket++)
+		index.bucketStart[bucket] = keyStart[MISSES ? bucket * 27 : bucket];
+
+	//Split the order into thirds, the leftovers go to the hardest level.
+	index.tierStart[EASY] = 0;
+	index.tierStart[MEDIUM] = PHRASE_NUM / 3;
+	index.tierStart[HARD] = PHRASE_NUM / 3 * 2;
+	index.tierStart[INVALID_DIFFICULTY] = PHRASE_NUM;
+
+	if (telemetry().enabled)
+		recordStep(SORT_PHRASES, START);
+	return index;
+}
+
+vector<uint8_t> calibrateCorpus(const Corpus& CORPUS, const string SCORES_FILE,
+	const bool REPORT)
+{
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	const auto START = chrono::steady_clock::now();
+	vector<uint8_t> misses(PHRASE_NUM); //Each phrase's score
+	vector<uint64_t> hashes(PHRASE_NUM); //Each phrase's hash
+	vector<uint32_t> missing; //Phrases with no score yet
+	ScoreCache cache;
+
+	//Look up every phrase, keeping the ones that haven't been scored.
+	readScoreCache(SCORES_FILE, cache);
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+	{
+		hashes[phrase] = contentHash(phraseText(CORPUS, phrase));
+		const auto FOUND = lower_bound(cache.hashes.begin(), cache.hashes.end(), 
+			hashes[phrase]);
+		if (FOUND != cache.hashes.end() && *FOUND == hashes[phrase])
+			misses[phrase] = cache.misses[FOUND - cache.hashes.begin()];
+		else
+			missing.push_back(static_cast<uint32_t>(phrase));
+	}
+	if (missing.empty())
+		return misses;
+
+	//Play the new phrases on every core, split and stolen the same way
+	//as a simulation. Each phrase's score is its own byte.
+	const unsigned int WORKERS = max(thread::hardware_concurrency(), 1u);
+	const uint64_t COUNT = missing.size();
+	vector<WorkRange> ranges(WORKERS);
+	vector<thread> threads;
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+		ranges[worker].range.store(COUNT * worker / WORKERS << 32 | 
+			COUNT * (worker + 1) / WORKERS);
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+	{
+		threads.emplace_back([&, worker]()
+		{
+			uint32_t first, last;
+			while (takeWork(ranges.data(), WORKERS, worker, first, last))
+				for (uint32_t slot = first; slot < last; slot++)
+					misses[missing[slot]] = scorePhrase(CORPUS.masks[missing[slot]]);
+		});
+	}
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+		threads[worker].join();
+
+	//Keep the scores of this corpus only, so the file doesn't grow forever.
+	vector<pair<uint64_t, uint8_t>> scored(PHRASE_NUM);
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		scored[phrase] = {hashes[phrase], misses[phrase]};
+	sort(scored.begin(), scored.end());
+	scored.erase(unique(scored.begin(), scored.end(), 
+		[](const pair<uint64_t, uint8_t>& A, const pair<uint64_t, uint8_t>& B) 
+		{ return A.first == B.first; }), scored.end());
+	cache.hashes.resize(scored.size());
+	cache.misses.resize(scored.size());
+	for (size_t entry = 0; entry < scored.size(); entry++)
+	{
+		cache.hashes[entry] = scored[entry].first;
+		cache.misses[entry] = scored[entry].second;
+	}
+	writeScoreCache(SCORES_FILE, cache);
+
+	if (REPORT)
+		cout << "Scored " << COUNT << " new phrases in " << fixed << setprecision(1)
+			<< chrono::duration<double, milli>(chrono::steady_clock::now() - START).count()
+			<< " ms, " << PHRASE_NUM - COUNT << " from " << SCORES_FILE << endl;
+	cout.unsetf(ios::floatfield);
+	return misses;
+}
+
+uint8_t scorePhrase(const unsigned int LETTER_MASK)
+{
+	unsigned int left = LETTER_MASK; //Letters not guessed yet
+	uint8_t misses = 0;
+
+	for (size_t index = 0; left != 0 && index < LETTER_FREQUENCY.length(); index++)
+	{
+		const unsigned int BIT = letterBit(LETTER_FREQUENCY[index]);
+		if (left & BIT)
+			left &= ~BIT;
+		else
+			misses++;
+	}
+	return misses;
+}
+
+uint64_t contentHash(const string_view TEXT, const uint64_t HASH)
+{
+	uint64_t hash = HASH;
+	for (size_t index = 0; index < TEXT.length(); index++)
+		hash = (hash ^ static_cast<unsigned char>(TEXT[index])) * 1099511628211ull;
+	return hash;
+}
+
+bool readScoreCache(const string FILE_NAME, ScoreCache& cache)
+{
+	ScoreHeader header;
+	ifstream fileIn(FILE_NAME, ios::binary | ios::ate);
+
+	cache.hashes.clear();
+	cache.misses.clear();
+	if (fileIn.fail())
+		return false;
+
+	//The header has to match and the file has to be exactly long enough.
+	const uint64_t SIZE = static_cast<uint64_t>(fileIn.tellg());
+	fileIn.seekg(0);
+	if (!fileIn.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		memcmp(header.magic, SCORE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != SCORE_VERSION || 
+		header.solver != static_cast<uint32_t>(contentHash(LETTER_FREQUENCY)) ||
+		header.count > (SIZE - sizeof(header)) / (sizeof(uint64_t) + 1) ||
+		SIZE != sizeof(header) + header.count * (sizeof(uint64_t) + 1))
+		return false;
+
+	cache.hashes.resize(header.count);
+	cache.misses.resize(header.count);
+	fileIn.read(reinterpret_cast<char*>(cache.hashes.data()), 
+		header.count * sizeof(uint64_t));
+	fileIn.read(reinterpret_cast<char*>(cache.misses.data()), header.count);
+	if (!fileIn || !is_sorted(cache.hashes.begin(), cache.hashes.end()))
+	{
+		cache.hashes.clear();
+		cache.misses.clear();
+		return false;
+	}
+	return true;
+}
+
+bool writeScoreCache(const string FILE_NAME, const ScoreCache& CACHE)
+{
+	ScoreHeader header = {};
+	memcpy(header.magic, SCORE_MAGIC, sizeof(header.magic));
+	header.version = SCORE_VERSION;
+	header.solver = static_cast<uint32_t>(contentHash(LETTER_FREQUENCY));
+	header.count = CACHE.hashes.size();
+
+	//Write a copy and rename it over the old file, the same as compileCorpus.
+	const string TEMP_FILE = FILE_NAME + ".tmp";
+	ofstream fileOut(TEMP_FILE, ios::binary);
+	fileOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fileOut.write(reinterpret_cast<const char*>(CACHE.hashes.data()), 
+		header.count * sizeof(uint64_t));
+	fileOut.write(reinterpret_cast<const char*>(CACHE.misses.data()), header.count);
+	fileOut.close();
+
+	error_code error;
+	if (!fileOut.fail())
+		filesystem::rename(TEMP_FILE, FILE_NAME, error);
+	if (fileOut.fail() || error)
+	{
+		filesystem::remove(TEMP_FILE, error);
+		return false;
+	}
+	return true;
+}
+
+//PASSED, DON'T TOUCH
+string phraseWithBlanks(const string_view CURRENT_PHRASE, const string_view CORRECT_GUESSES)
+{
+	//When every guess is a letter, the whole phrase is done at once.
+	if (!CURRENT_PHRASE.empty() && all_of(CORRECT_GUESSES.begin(), 
+		CORRECT_GUESSES.end(), [](char ch) { return letterBit(ch) != 0; }))
+	{
+		string rendered(CURRENT_PHRASE.length() * 2, ' ');
+		letterKernels().renderBlanks(CURRENT_PHRASE.data(), CURRENT_PHRASE.length(),
+			buildLetterMask(CORRECT_GUESSES), &rendered[0]);
+		rendered.pop_back();
+		return rendered;
+	}
+
+	//character to build the actual phrase
+	char buildPhrase;
+
+	//string to hold the final product.
+	string holdPhrase = "";
+
+	//bool to know what function to call.
+	bool noLength = false;
+
+	//If there is no guess value make no length true.
+	if (CORRECT_GUESSES.length() == 0)
+		noLength = true;
+
+	//at every character in holdphrase, loop through every character held in
+	//the guessed characters to determine how to display the output.
+	for (unsigned int index = 0; index < CURRENT_PHRASE.length(); index++)
+	{//Begin outer for loop
+		//What to do if the guesses have length.
+		if (!noLength)
+		{
+			for (unsigned int iter = 0; iter < CORRECT_GUESSES.length(); iter++)
+			{
+				buildPhrase = withGuesses(CURRENT_PHRASE[index], CORRECT_GUESSES[iter]);
+
+				//Break the loop if buildphrase is a character or punctuation.
+				if (buildPhrase != '_')
+					break;
+			}
+		}
+
+		//there is no length to the correct guesses.
+		else
+		{
+			buildPhrase = withoutGuesses(CURRENT_PHRASE[index]);
+		}
+		
+		//Use buildPhrase to create the whole phrase in holdPhrase.
+		holdPhrase += buildPhrase;
+		if (index + 1 != CURRENT_PHRASE.length())
+			holdPhrase += ' ';
+	}//End outer loop
+
+	return holdPhrase;
+}
+
+template <class R>
+BasicReveal<R> startReveal(const string_view SINGLE_PHRASE)
+{
+	BasicReveal<R> reveal;
+	unsigned int letterCount[R::SYMBOLS] = {0}; //Times each symbol appears
+	unsigned int next[R::SYMBOLS]; //Where the next position of each symbol goes
+	typename R::Mask mask = 0; //Every symbol in the phrase
+
+	//Every character takes two spots, itself and a space between.
+	reveal.blankPhrase.resize(SINGLE_PHRASE.empty() ? 0 : SINGLE_PHRASE.length() * 2 - 1, ' ');
+
+	//Show punctuation and spaces, blank out letters and count them.
+	for (unsigned int index = 0; index < SINGLE_PHRASE.length(); index++)
+	{
+		const int SYMBOL = R::TABLE.symbol[static_cast<unsigned char>(SINGLE_PHRASE[index])];
+		if (SYMBOL < 0)
+			reveal.blankPhrase[index * 2] = SINGLE_PHRASE[index];
+		else
+		{
+			reveal.blankPhrase[index * 2] = '_';
+			letterCount[SYMBOL]++;
+			mask |= static_cast<typename R::Mask>(1) << SYMBOL;
+		}
+	}
+
+	//Lay the symbols out one after another in alphabetical order.
+	reveal.letterStart[0] = 0;
+	for (int letter = 0; letter < R::SYMBOLS; letter++)
+	{
+		next[letter] = reveal.letterStart[letter];
+		reveal.letterStart[letter + 1] = 
+			reveal.letterStart[letter] + letterCount[letter];
+	}
+
+	//Record where each symbol is, and the case it is shown in.
+	reveal.positions.resize(reveal.letterStart[R::SYMBOLS]);
+	reveal.letters.resize(reveal.letterStart[R::SYMBOLS]);
+	for (unsigned int index = 0; index < SINGLE_PHRASE.length(); index++)
+	{
+		const int SYMBOL = R::TABLE.symbol[static_cast<unsigned char>(SINGLE_PHRASE[index])];
+		if (SYMBOL >= 0)
+		{
+			const unsigned int SLOT = next[SYMBOL]++;
+			reveal.positions[SLOT] = index * 2;
+			reveal.letters[SLOT] = SINGLE_PHRASE[index];
+		}
+	}
+
+	reveal.lettersLeft = static_cast<unsigned int>(bitset<R::SYMBOLS>(mask).count());
+	return reveal;
+}
+
+template <class R>
+void revealLetter(BasicReveal<R>& reveal, const typename R::Mask LETTER_BIT)
+{
+	//Find which symbol the bit is for.
+	const int LETTER = __builtin_ctzll(LETTER_BIT);
+
+	//Only the spots that hold this letter change.
+	for (unsigned int slot = reveal.letterStart[LETTER]; 
+		slot < reveal.letterStart[LETTER + 1]; slot++)
+		reveal.blankPhrase[reveal.positions[slot]] = reveal.letters[slot];
+
+	reveal.lettersLeft--;
+}
+
+//WORKING, DON'T TOUCH
+char withGuesses(char currentVal, char guessVal)
+{
+	//If the character in the actual phrase is the same as the guess in
+	//either case, show it. Otherwise it is shown the same as without
+	//any guesses.
+	if (toLower(currentVal) == toLower(guessVal))
+		return currentVal;
+	return withoutGuesses(currentVal);
+}
+
+//WORKING, DON'T TOUCH
+char withoutGuesses(char currentVal)
+{
+	//Letters show as blanks, anything else as it is.
+	return CHAR_TABLE.hidden[static_cast<unsigned char>(currentVal)];
+}
+
+//PASSED, DON'T TOUCH
+DifficultyLevel getDifficultyLevel()
+{
+	//Holds difficulty level
+	int diff;
+	DifficultyLevel val;
+
+	//Display banner
+	cout << "Difficulty levels:" << endl;
+	cout << setw(5) << right << "1" << "  Easy" << endl; 
+	cout << setw(5) << right << "2" << "  Medium" << endl;
+	cout << setw(5) << right << "3" << "  Hard" << endl;
+
+	//Get difficulty
+	cout << "Pick a difficulty level (1 to 3): ";
+	cin >> diff;
+	cin.clear();
+	cin.ignore(256, '\n');
+	cout << endl;
+
+	//Only occurs if the user inputs a number outside of 1-3
+	while (diff < 1 || diff > 3)
+	{
+		cout << "Please choose a difficulty level between 1 and 3: ";
+		cin >> diff;
+		cin.clear();
+		cin.ignore(256, '\n');
+		cout << endl;
+	}
+
+	//convert the diff to corresponding enum value after subtracting 1.
+	switch (--diff)
+	{
+		case 0:
+			val = EASY;
+			break;
+		case 1:
+			val = MEDIUM;
+			break;
+		case 2:
+			val = HARD;
+			break;
+		default:
+			val = INVALID_DIFFICULTY;
+
+	}
+	return val;
+}
+
+//PROBABLY WORKING, DON'T TOUCH
+string convertDifficulty(DifficultyLevel diff)
+{
+	string level;
+
+	switch (diff)
+	{
+		case EASY:
+			level = "Easy";
+			break;
+		case MEDIUM:
+			level = "Medium";
+			break;
+		case HARD:
+			level = "Hard";
+			break;
+		default:
+			level = "Invalid";
+	}
+	return level;
+}
+
+int chooseLevel(const int LEVELS)
+{
+	int level = 0;
+
+	//Keep asking until it is one of the levels.
+	while (level < 1 || level > LEVELS)
+	{
+		cout << "Pick a difficulty level (1 is easiest, " << LEVELS << " is hardest): ";
+		cin >> level;
+		cin.clear();
+		cin.ignore(256, '\n');
+		cout << endl;
+	}
+	return level - 1;
+}
+
+template <int LEVELS>
+string levelName(const int LEVEL)
+{
+	if constexpr (LEVELS == INVALID_DIFFICULTY)
+		return convertDifficulty(static_cast<DifficultyLevel>(LEVEL));
+	else
+		return "level " + to_string(LEVEL + 1);
+}
+
+template <int LEVELS>
+BasicPhrasePool<LEVELS> buildPhrasePool(const DifficultyIndex& INDEX)
+{
+	BasicPhrasePool<LEVELS> pool;
+
+	//Start with the phrases in the same order as the index, with the
+	//index's levels or an even split into some other number of them.
+	pool.slots = INDEX.order;
+	pool.slotOf.resize(pool.slots.size());
+	for (size_t slot = 0; slot < pool.slots.size(); slot++)
+		pool.slotOf[pool.slots[slot]] = static_cast<int>(slot);
+	if constexpr (LEVELS == INVALID_DIFFICULTY)
+		copy(begin(INDEX.tierStart), end(INDEX.tierStart), begin(pool.tierStart));
+	else
+		for (int level = 0; level <= LEVELS; level++)
+			pool.tierStart[level] = static_cast<int>(
+				static_cast<long long>(INDEX.order.size()) * level / LEVELS);
+
+	//Nothing has been used yet.
+	for (int level = 0; level < LEVELS; level++)
+	{
+		pool.unusedCount[level] = pool.tierStart[level + 1] - pool.tierStart[level];
+		pool.epoch[level] = 1;
+	}
+
+	return pool;
+}
+
+template <int LEVELS>
+bool isUsed(const BasicPhrasePool<LEVELS>& POOL, const int PHRASE)
+{
+	//Find the phrase's level, then see if it is past the unused ones.
+	const int SLOT = POOL.slotOf[PHRASE];
+	int level = 0;
+	while (SLOT >= POOL.tierStart[level + 1])
+		level++;
+	return SLOT - POOL.tierStart[level] >= POOL.unusedCount[level];
+}
+
+template <int LEVELS>
+int randomPhraseIndex(int diff, BasicPhrasePool<LEVELS>& pool, Random& rng)
+{
+	//Make sure the difficulty is one of the levels.
+	if (diff < 0 || diff >= LEVELS)
+	{
+		cout << convertDifficulty(INVALID_DIFFICULTY);
+		return -1;
+	}
+
+	//With fewer phrases than levels the easier levels are empty, so
+	//use the next harder level. The hardest level is never empty.
+	while (pool.tierStart[diff] == pool.tierStart[diff + 1] && diff < LEVELS - 1)
+		diff++;
+
+	const int START = pool.tierStart[diff];
+	const int SIZE = pool.tierStart[diff + 1] - START;
+
+	if (SIZE == 0)
+		return -1;
+
+	//Once every phrase in the level has been used, start a new epoch.
+	//Every slot counts as unused again, so no phrase has to be touched.
+	if (pool.unusedCount[diff] == 0)
+	{
+		pool.unusedCount[diff] = SIZE;
+		pool.epoch[diff]++;
+		cout << "Every " << levelName<LEVELS>(diff)
+			<< " phrase has been used, starting pass " << pool.epoch[diff] << "." << endl;
+	}
+
+	//Pick one of the unused phrases, then swap it with the last unused
+	//phrase so the unused ones stay together at the front.
+	const int PICK = START + static_cast<int>(randomBelow(rng, 
+		static_cast<unsigned int>(pool.unusedCount[diff])));
+	const int LAST = START + --pool.unusedCount[diff];
+	const int RANDI = pool.slots[PICK];
+	pool.slots[PICK] = pool.slots[LAST];
+	pool.slots[LAST] = RANDI;
+	pool.slotOf[pool.slots[PICK]] = PICK;
+	pool.slotOf[RANDI] = LAST;
+
+	return RANDI;
+}
+
+template <class R>
+void runGame(const Corpus& CORPUS, const int PHRASE_INDEX,
+	const Solver* BOT, PatternIndex* hints)
+{
+	constexpr bool STANDARD = is_same_v<R, StandardRules>;
+
+	//Holds the guesses and the phrase with blanks
+	BasicGame<R> game = startGame<R>(CORPUS, PHRASE_INDEX);
+
+	//Holds the phrases the bot thinks it could be
+	SolverGame solverGame;
+	if constexpr (STANDARD)
+	{
+		if (BOT)
+			solverGame = startSolverGame(*BOT, game);
+	}
+	else
+		BOT = nullptr;
+
+	//Char guess from the user.
+	char currentGuess;
+
+	//Holds everything shown for a turn so it is written all at once.
+	string frame(CLEAR_SCREEN);
+
+	do
+	{//Begin do...while loop
+		//Draw the gallows based on the number of incorrect guesses.
+		drawGallows<R>(frame, game.guess[1].numOfGuesses);
+
+		//Output the blank phrase
+		frame += game.reveal.blankPhrase;
+		frame += "\nPrevious incorrect guesses: ";
+		frame += game.guess[1].charGuesses;
+
+		//Find the user's character guess, or the bot's
+		frame += "\nEnter guess: ";
+		if (BOT)
+		{
+			if constexpr (STANDARD)
+				currentGuess = pickGuess(*BOT, solverGame, game);
+			frame += currentGuess;
+			frame += '\n';
+			writeFrame(frame);
+		}
+		else
+		{
+			writeFrame(frame);
+			const auto ASKED = chrono::steady_clock::now();
+			cin >> currentGuess;
+			cin.clear();
+			cin.ignore(256, '\n');
+			if (telemetry().enabled)
+				recordLatency(telemetryShard().turnLatency, 
+					chrono::steady_clock::now() - ASKED);
+		}
+
+		//convert to lowercase if the rules don't care about case.
+		currentGuess = R::TABLE.guessed[static_cast<unsigned char>(currentGuess)];
+
+		//Clear the screen, then check the guess
+		frame += CLEAR_SCREEN;
+
+		//A question mark asks for a hint instead of guessing.
+		if constexpr (STANDARD)
+		{
+			if (currentGuess == '?' && hints)
+			{
+				if (hints->phraseNum == 0)
+					*hints = buildPatternIndex(CORPUS);
+				showHint(frame, *hints, game);
+				continue;
+			}
+		}
+
+		showGuessResult(frame, playGuess(game, currentGuess), currentGuess);
+
+		//Check for victory
+	} while (!gameOver(game)); 
+	/*end do...while loop*/ 
+
+	//Show the results with the final phrase with blanks
+	displayResult<R>(frame, game.guess[1].numOfGuesses, 
+		phraseText(CORPUS, PHRASE_INDEX), game.reveal.blankPhrase);	
+}
+
+template <class R>
+BasicGame<R> startGame(const Corpus& CORPUS, const int PHRASE_INDEX)
+{
+	BasicGame<R> game;
+	game.phraseIndex = PHRASE_INDEX;
+
+	//Index 0 is correct, index 1 is wrong, index 2 holds all
+	for (int index = 0; index < 3; index++)
+	{
+		game.guess[index].charGuesses = "";
+		game.guess[index].numOfGuesses = 0;
+		game.guess[index].letterMask = 0;
+	}
+
+	game.reveal = startReveal<R>(phraseText(CORPUS, PHRASE_INDEX));
+	game.seed = 0;
+
+	//The corpus has the letters of every phrase, other rules gather the
+	//symbols from the reveal state.
+	if constexpr (is_same_v<R, StandardRules>)
+		game.phraseMask = CORPUS.masks[PHRASE_INDEX];
+	else
+	{
+		game.phraseMask = 0;
+		for (int symbol = 0; symbol < R::SYMBOLS; symbol++)
+			if (game.reveal.letterStart[symbol] != game.reveal.letterStart[symbol + 1])
+				game.phraseMask |= static_cast<typename R::Mask>(1) << symbol;
+	}
+	return game;
+}
+
+template <class R>
+GuessResult playGuess(BasicGame<R>& game, char userGuess)
+{
+	GuessResult result = LOST;
+	Telemetry& stats = telemetry();
+
+	//Fold the case here if the rules don't care about it.
+	userGuess = R::TABLE.guessed[static_cast<unsigned char>(userGuess)];
+
+	//A finished game doesn't take any more guesses.
+	if (gameOver(game))
+		return checkVictory(game.reveal) ? WON : LOST;
+
+	if (!stats.enabled)
+		result = checkGuess(userGuess, game.phraseMask, 
+			game.guess, game.reveal);
+	else
+	{
+		//Only some guesses are timed so the clock stays out of the way.
+		TelemetryShard& shard = telemetryShard();
+		if (shard.untilSample-- == 0)
+		{
+			shard.untilSample = LATENCY_SAMPLE - 1;
+			const auto START = chrono::steady_clock::now();
+			result = checkGuess(userGuess, game.phraseMask, 
+				game.guess, game.reveal);
+			recordLatency(shard.guessLatency, chrono::steady_clock::now() - START);
+		}
+		else
+			result = checkGuess(userGuess, game.phraseMask, 
+				game.guess, game.reveal);
+	}
+
+	//Report the guess that finished the game as the result of the game.
+	if (gameOver(game))
+	{
+		result = checkVictory(game.reveal) ? WON : LOST;
+		if constexpr (is_same_v<R, StandardRules>)
+			if (replayLog().enabled)
+				logGame(game, result == WON);
+	}
+
+	if (stats.enabled)
+		countGuess(game.phraseIndex, result, game.guess[2].numOfGuesses, 
+			game.guess[1].numOfGuesses);
+	return result;
+}
+
+template <class R>
+bool gameOver(const BasicGame<R>& GAME)
+{
+	return checkVictory(GAME.reveal) || GAME.guess[1].numOfGuesses >= R::MAX_MISSES;
+}
+
+void countGuess(const int PHRASE_INDEX, const GuessResult RESULT, 
+	const unsigned int GUESSES, const unsigned int MISSES)
+{
+	Telemetry& stats = telemetry();
+	if (static_cast<size_t>(PHRASE_INDEX) < stats.plays.size())
+	{
+		//A game counts as played once it has its first real guess.
+		if (GUESSES == 1 && RESULT != REPEAT && RESULT != INVALID_GUESS)
+			stats.plays[PHRASE_INDEX].fetch_add(1, memory_order_relaxed);
+		if (RESULT == WON)
+			stats.wins[PHRASE_INDEX].fetch_add(1, memory_order_relaxed);
+		if (RESULT == WON || RESULT == LOST)
+			stats.misses[PHRASE_INDEX].fetch_add(MISSES, memory_order_relaxed);
+	}
+	bumpCounter(telemetryShard().results[RESULT]);
+}
+
+CompactGame startCompactGame(const int PHRASE_INDEX)
+{
+	CompactGame game = {};
+	game.phraseIndex = static_cast<uint32_t>(PHRASE_INDEX);
+	return game;
+}
+
+GuessResult checkCompactGuess(CompactGame& game, const unsigned int PHRASE_MASK, 
+	const char USER_GUESS)
+{
+	const unsigned int BIT = letterBit(USER_GUESS);
+
+	//A finished game doesn't take any more guesses.
+	if (game.correctMask == PHRASE_MASK)
+		return WON;
+	if (game.misses >= MAX_MISSES)
+		return LOST;
+
+	//Anything that isn't a letter, or is a letter guessed before.
+	if (BIT == 0)
+		return INVALID_GUESS;
+	if (game.guessedMask & BIT)
+		return REPEAT;
+
+	game.guessedMask |= BIT;
+	game.guesses++;
+	if (PHRASE_MASK & BIT)
+	{
+		game.correctMask |= BIT;
+		return game.correctMask == PHRASE_MASK ? WON : HIT;
+	}
+	return ++game.misses >= MAX_MISSES ? LOST : MISS;
+}
+
+GuessResult playCompactGuess(CompactGame& game, GuessHistory& history, 
+	const Corpus& CORPUS, const char USER_GUESS, const uint64_t SEED)
+{
+	const unsigned int PHRASE_MASK = CORPUS.masks[game.phraseIndex];
+
+	//A finished game doesn't take any more guesses, or count them.
+	if (game.correctMask == PHRASE_MASK || game.misses >= MAX_MISSES)
+		return game.correctMask == PHRASE_MASK ? WON : LOST;
+
+	//A letter that counted goes next in the history.
+	const unsigned int BEFORE = game.guesses;
+	const GuessResult RESULT = checkCompactGuess(game, PHRASE_MASK, USER_GUESS);
+	if (game.guesses != BEFORE)
+	{
+		const unsigned int SHIFT = BEFORE * 5;
+		const uint64_t LETTER = static_cast<uint64_t>(__builtin_ctz(letterBit(USER_GUESS)));
+		history.bits[SHIFT / 64] |= LETTER << (SHIFT % 64);
+		if (SHIFT % 64 > 59)
+			history.bits[SHIFT / 64 + 1] |= LETTER >> (64 - SHIFT % 64);
+	}
+
+	if ((RESULT == WON || RESULT == LOST) && replayLog().enabled)
+		logCompactGame(CORPUS, game, history, SEED, RESULT == WON);
+	//A reloaded corpus numbers its phrases differently, so its games only
+	//count toward the totals and not toward any phrase.
+	const Telemetry& STATS = telemetry();
+	if (STATS.enabled)
+		countGuess(&CORPUS == STATS.corpus ? static_cast<int>(game.phraseIndex) : -1, 
+			RESULT, game.guesses, game.misses);
+	return RESULT;
+}
+
+string compactBlanks(const Corpus& CORPUS, const CompactGame& GAME)
+{
+	const string_view TEXT = phraseText(CORPUS, static_cast<int>(GAME.phraseIndex));
+	string rendered(TEXT.length() * 2, ' ');
+	letterKernels().renderBlanks(TEXT.data(), TEXT.length(), GAME.correctMask, 
+		&rendered[0]);
+	if (!rendered.empty())
+		rendered.pop_back();
+	return rendered;
+}
+
+void showGuessResult(string& frame, const GuessResult RESULT, const char USER_GUESS)
+{
+	switch (RESULT)
+	{
+		case INVALID_GUESS:
+			frame += "'";
+			frame += USER_GUESS;
+			frame += "' is not a valid guess. Please enter a letter.\n";
+			break;
+		case REPEAT:
+			frame += "You have already guessed an '";
+			frame += USER_GUESS;
+			frame += "'.\n";
+			break;
+		case HIT:
+		case WON:
+			frame += "Good guess!\n";
+			break;
+		case MISS:
+		case LOST:
+			frame += "Sorry, bad guess.\n";
+	}
+}
+
+template <class R>
+void displayResult(string& frame, int wrongGuesses, 
+	const string_view PHRASE, const string BLANK_PHRASE)
+{
+	//Show the gallows one last time
+	drawGallows<R>(frame, wrongGuesses);
+
+	//Display the blank phrase onelast time
+	frame += BLANK_PHRASE;
+	frame += '\n';
+
+	//If they used up every miss
+	if (wrongGuesses == static_cast<int>(R::MAX_MISSES))
+	{
+		frame += "You're Dead! The phrase was:\n\"";
+		frame += phraseWithBlanks(PHRASE, PHRASE);
+		frame += "\"\n";
+	}
+
+	//If they won
+	else 
+		frame += "You Win!\n";
+
+	writeFrame(frame);
+}
+
+//PROBABLY WORKING
+template <class R>
+GuessResult checkGuess(const char USER_GUESS, const typename R::Mask PHRASE_MASK, 
+	BasicGuesses<R> guess[], BasicReveal<R>& reveal)
+{
+	const typename R::Mask BIT = static_cast<typename R::Mask>(
+		R::TABLE.bit[static_cast<unsigned char>(USER_GUESS)]);
+
+	//If the guess is not a letter
+	if (BIT == 0)
+		return INVALID_GUESS;
+
+	//If the guess has already been guessed.
+	if (guess[2].letterMask & BIT)
+		return REPEAT;
+
+	//Add the guessed character to the total guesses.
+	guess[2].charGuesses += USER_GUESS;
+	guess[2].numOfGuesses++;
+	guess[2].letterMask |= BIT;
+
+	//If the letter is in the phrase, increment and update the correct
+	//guesses.  If it is not, increment and update the wrong guesses.
+	if (PHRASE_MASK & BIT)
+	{
+		guess[0].charGuesses += USER_GUESS;
+		guess[0].numOfGuesses++;
+		guess[0].letterMask |= BIT;
+		revealLetter(reveal, BIT);
+		return HIT;
+	}
+
+	guess[1].charGuesses += USER_GUESS;
+	guess[1].numOfGuesses++;
+	guess[1].letterMask |= BIT;
+	return MISS;
+}
+
+char toLower(char uGuess)
+{
+	return CHAR_TABLE.lower[static_cast<unsigned char>(uGuess)];
+}
+
+template <class R>
+bool checkVictory(const BasicReveal<R>& REVEAL)
+{
+	return REVEAL.lettersLeft == 0;
+}
+
+Solver buildSolver(const Corpus& CORPUS,
+	const SolverStrategy STRATEGY, const double BUDGET_MICROS)
+{
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	Solver solver;
+	int phrasesWith[26] = {0}; //Number of phrases with each letter
+	size_t longest = 0; //Length of the longest phrase
+
+	solver.strategy = STRATEGY;
+	solver.corpus = &CORPUS;
+	solver.budget = chrono::nanoseconds(static_cast<long long>(BUDGET_MICROS * 1000));
+
+	//Count the phrases each letter is in using their masks.
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+	{
+		for (int letter = 0; letter < 26; letter++)
+			if (CORPUS.masks[phrase] & (1u << letter))
+				phrasesWith[letter]++;
+		longest = max(longest, phraseText(CORPUS, phrase).length());
+	}
+
+	//Order the letters from the most common to the least.
+	solver.letterOrder = "abcdefghijklmnopqrstuvwxyz";
+	stable_sort(solver.letterOrder.begin(), solver.letterOrder.end(),
+		[&phrasesWith](char first, char second)
+		{ return phrasesWith[first - 'a'] > phrasesWith[second - 'a']; });
+
+	//Group the phrases by length with a counting sort.
+	solver.lengthStart.assign(longest + 2, 0);
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		solver.lengthStart[phraseText(CORPUS, phrase).length() + 1]++;
+	for (size_t length = 0; length <= longest; length++)
+		solver.lengthStart[length + 1] += solver.lengthStart[length];
+
+	vector<int> next(solver.lengthStart.begin(), solver.lengthStart.end() - 1);
+	solver.byLength.resize(PHRASE_NUM);
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		solver.byLength[next[phraseText(CORPUS, phrase).length()]++] = phrase;
+
+	return solver;
+}
+
+SolverGame startSolverGame(const Solver& SOLVER, const Game& GAME)
+{
+	SolverGame solverGame;
+
+	//Every character and the space after it, except the last.
+	const size_t LENGTH = (GAME.reveal.blankPhrase.length() + 1) / 2;
+
+	//Any phrase with the same length could be the answer.
+	if (SOLVER.strategy == ELIMINATION && LENGTH + 1 < SOLVER.lengthStart.size())
+		solverGame.candidates.assign(
+			SOLVER.byLength.begin() + SOLVER.lengthStart[LENGTH],
+			SOLVER.byLength.begin() + SOLVER.lengthStart[LENGTH + 1]);
+
+	return solverGame;
+}
+
+char pickGuess(const Solver& SOLVER, SolverGame& solverGame, const Game& GAME)
+{
+	const unsigned int GUESSED = GAME.guess[2].letterMask;
+	const unsigned int WRONG = GAME.guess[1].letterMask;
+	const unsigned int RIGHT = GAME.guess[0].letterMask;
+	const bool TIMED = SOLVER.budget.count() > 0;
+	const auto DEADLINE = chrono::steady_clock::now() + SOLVER.budget;
+	bool outOfTime = false;
+	size_t kept = 0; //Candidates that still fit go to the front
+	int phrasesWith[26] = {0}; //Candidates with each unguessed letter
+
+	//Throw out the candidates that don't fit the pattern anymore and
+	//count the letters of the ones that do. Check the clock every so
+	//often in case time runs out.
+	if (SOLVER.strategy == ELIMINATION)
+	{
+		for (size_t index = 0; index < solverGame.candidates.size(); index++)
+		{
+			const int PHRASE = solverGame.candidates[index];
+			const unsigned int MASK = SOLVER.corpus->masks[PHRASE];
+
+			//Keep the rest unchecked once time is up.
+			if (TIMED && (index & 31) == 31 && chrono::steady_clock::now() > DEADLINE)
+			{
+				outOfTime = true;
+				kept = copy(solverGame.candidates.begin() + index, 
+					solverGame.candidates.end(), 
+					solverGame.candidates.begin() + kept) - solverGame.candidates.begin();
+				break;
+			}
+
+			if ((MASK & WRONG) == 0 && (MASK & RIGHT) == RIGHT &&
+				matchesPattern(phraseText(*SOLVER.corpus, PHRASE), 
+				GAME.reveal.blankPhrase, GUESSED))
+			{
+				solverGame.candidates[kept++] = PHRASE;
+				unsigned int left = MASK & ~GUESSED;
+				for (int letter = 0; left != 0; letter++, left >>= 1)
+					phrasesWith[letter] += left & 1;
+			}
+		}
+		solverGame.candidates.resize(kept);
+	}
+
+	//Pick the unguessed letter that is in the most candidates.
+	if (SOLVER.strategy == ELIMINATION && !outOfTime && kept > 0)
+	{
+		//Ties go to the more common letter.
+		char best = 0;
+		for (size_t order = 0; order < SOLVER.letterOrder.length(); order++)
+		{
+			const char LETTER = SOLVER.letterOrder[order];
+			if (phrasesWith[LETTER - 'a'] > 0 && 
+				(best == 0 || phrasesWith[LETTER - 'a'] > phrasesWith[best - 'a']))
+				best = LETTER;
+		}
+		if (best != 0)
+			return best;
+	}
+
+	//Otherwise guess the most common letter that hasn't been guessed.
+	for (size_t order = 0; order < SOLVER.letterOrder.length(); order++)
+		if (maybeUnique(GUESSED, SOLVER.letterOrder[order]))
+			return SOLVER.letterOrder[order];
+
+	return 'a';
+}
+
+bool matchesPattern(const string_view TEXT, const string& BLANK_PHRASE,
+	const unsigned int GUESSED_MASK)
+{
+	//The phrase with blanks has a space between every character.
+	if (TEXT.length() * 2 - 1 != BLANK_PHRASE.length())
+		return false;
+
+	return letterKernels().matchesPattern(TEXT.data(), TEXT.length(), 
+		BLANK_PHRASE.data(), GUESSED_MASK);
+}
+
+PatternIndex buildPatternIndex(const Corpus& CORPUS)
+{
+	PatternIndex index;
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	vector<pair<uint64_t, int>> shapes(PHRASE_NUM); //Each phrase's shape
+	size_t longest = 0; //Length of the longest phrase
+
+	//Rank the phrases by shape, keeping file order within a shape.
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+	{
+		shapes[phrase] = {shapeKey(phraseText(CORPUS, phrase), 1), phrase};
+		longest = max(longest, phraseText(CORPUS, phrase).length());
+	}
+	sort(shapes.begin(), shapes.end());
+
+	index.byShape.resize(PHRASE_NUM);
+	for (int rank = 0; rank < PHRASE_NUM; rank++)
+	{
+		index.byShape[rank] = shapes[rank].second;
+		if (rank == 0 || shapes[rank].first != shapes[rank - 1].first)
+		{
+			index.shapeKeys.push_back(shapes[rank].first);
+			index.shapeStart.push_back(rank);
+		}
+	}
+	index.shapeStart.push_back(PHRASE_NUM);
+
+	//Set the bit for every letter of every phrase, and for the letter at
+	//each of its positions. Ranks only go up, so a position's run only
+	//ever grows at the end.
+	index.words = (PHRASE_NUM + 63) / 64;
+	index.letterBits.assign(26 * index.words, 0);
+	vector<vector<pair<uint32_t, uint64_t>>> cells(longest * 26);
+	for (int rank = 0; rank < PHRASE_NUM; rank++)
+	{
+		const int PHRASE = index.byShape[rank];
+		const string_view TEXT = phraseText(CORPUS, PHRASE);
+		const uint32_t WORD = static_cast<uint32_t>(rank / 64);
+		const uint64_t BIT = uint64_t(1) << (rank % 64);
+
+		unsigned int left = CORPUS.masks[PHRASE];
+		for (int letter = 0; left != 0; letter++, left >>= 1)
+			if (left & 1)
+				index.letterBits[letter * index.words + WORD] |= BIT;
+
+		for (size_t position = 0; position < TEXT.length(); position++)
+		{
+			if (letterBit(TEXT[position]) == 0)
+				continue;
+			vector<pair<uint32_t, uint64_t>>& run = 
+				cells[position * 26 + (toLower(TEXT[position]) - 'a')];
+			if (run.empty() || run.back().first != WORD)
+				run.push_back({WORD, 0});
+			run.back().second |= BIT;
+		}
+	}
+
+	//Lay the runs out one after another.
+	index.cellStart.assign(1, 0);
+	for (size_t cell = 0; cell < cells.size(); cell++)
+	{
+		for (size_t entry = 0; entry < cells[cell].size(); entry++)
+		{
+			index.cellWord.push_back(cells[cell][entry].first);
+			index.cellBits.push_back(cells[cell][entry].second);
+		}
+		index.cellStart.push_back(static_cast<uint32_t>(index.cellWord.size()));
+		vector<pair<uint32_t, uint64_t>>().swap(cells[cell]);
+	}
+
+	index.phraseNum = PHRASE_NUM;
+	index.corpus = &CORPUS;
+	return index;
+}
+
+uint64_t shapeKey(const string_view TEXT, const size_t STEP)
+{
+	//FNV-1a over the shape.
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t index = 0; index < TEXT.length(); index += STEP)
+	{
+		const char SHOWN = TEXT[index] == '_' || letterBit(TEXT[index]) != 0 ? 
+			'_' : TEXT[index];
+		hash = (hash ^ static_cast<unsigned char>(SHOWN)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+int queryPattern(const PatternIndex& INDEX, const string& BLANK_PHRASE,
+	const string& WRONG_GUESSES, PatternMatches& matches)
+{
+	matches.bits.clear();
+	matches.count = 0;
+
+	//Only phrases with the same shape can fit.
+	const uint64_t KEY = shapeKey(BLANK_PHRASE, 2);
+	const auto SHAPE = lower_bound(INDEX.shapeKeys.begin(), INDEX.shapeKeys.end(), KEY);
+	if (SHAPE == INDEX.shapeKeys.end() || *SHAPE != KEY)
+		return 0;
+	const size_t FIRST = INDEX.shapeStart[SHAPE - INDEX.shapeKeys.begin()];
+	const size_t LAST = INDEX.shapeStart[SHAPE - INDEX.shapeKeys.begin() + 1];
+	const size_t FIRST_WORD = FIRST / 64;
+	const size_t LAST_WORD = (LAST + 63) / 64;
+
+	//Start with every rank of the shape.
+	matches.firstWord = FIRST_WORD;
+	matches.bits.assign(LAST_WORD - FIRST_WORD, ~uint64_t(0));
+	matches.bits.front() &= ~uint64_t(0) << (FIRST % 64);
+	if (LAST % 64 != 0)
+		matches.bits.back() &= ~(~uint64_t(0) << (LAST % 64));
+
+	const size_t WORDS = matches.bits.size();
+	const unsigned int SHOWN_MASK = buildLetterMask(BLANK_PHRASE);
+	const unsigned int WRONG_MASK = buildLetterMask(WRONG_GUESSES);
+
+	//Adds up the bits left.
+	auto countLeft = [&]()
+	{
+		int left = 0;
+		for (size_t word = 0; word < WORDS; word++)
+			left += static_cast<int>(bitset<64>(matches.bits[word]).count());
+		return left;
+	};
+
+	//With only a few left, reading their text is faster than the bitsets.
+	auto checkText = [&]()
+	{
+		matches.count = 0;
+		for (size_t word = 0; word < WORDS; word++)
+		{
+			for (uint64_t bits = matches.bits[word]; bits != 0; bits &= bits - 1)
+			{
+				const int BIT = __builtin_ctzll(bits);
+				const int PHRASE = INDEX.byShape[(FIRST_WORD + word) * 64 + BIT];
+				if (matchesPattern(phraseText(*INDEX.corpus, PHRASE), BLANK_PHRASE, 
+					SHOWN_MASK | WRONG_MASK))
+					matches.count++;
+				else
+					matches.bits[word] &= ~(uint64_t(1) << BIT);
+			}
+		}
+		return matches.count;
+	};
+
+	//Wrong letters can't be anywhere.
+	for (int letter = 0; letter < 26; letter++)
+		if (WRONG_MASK & (1u << letter))
+			for (size_t word = 0; word < WORDS; word++)
+				matches.bits[word] &= 
+					~INDEX.letterBits[letter * INDEX.words + FIRST_WORD + word];
+	if (countLeft() <= TEXT_CHECK_LIMIT)
+		return checkText();
+
+	//Shown letters have to be at the same positions. The run and the bits
+	//are both in word order, so they are walked together.
+	const size_t LENGTH = (BLANK_PHRASE.length() + 1) / 2;
+	const size_t POSITIONS = (INDEX.cellStart.size() - 1) / 26;
+	for (size_t position = 0; position < LENGTH && position < POSITIONS; position++)
+	{
+		if (letterBit(BLANK_PHRASE[position * 2]) == 0)
+			continue;
+		const size_t CELL = position * 26 + (toLower(BLANK_PHRASE[position * 2]) - 'a');
+		const uint32_t* const END = INDEX.cellWord.data() + INDEX.cellStart[CELL + 1];
+		const uint32_t* entry = lower_bound(INDEX.cellWord.data() + INDEX.cellStart[CELL],
+			END, FIRST_WORD);
+		int left = 0;
+		for (size_t word = 0; word < WORDS; word++)
+		{
+			if (entry != END && *entry == FIRST_WORD + word)
+				matches.bits[word] &= INDEX.cellBits[entry++ - INDEX.cellWord.data()];
+			else
+				matches.bits[word] = 0;
+			left += static_cast<int>(bitset<64>(matches.bits[word]).count());
+		}
+		if (left <= TEXT_CHECK_LIMIT)
+			return checkText();
+	}
+
+	//Blanks can't hide a letter that was shown somewhere else.
+	for (size_t position = 0; position < LENGTH && position < POSITIONS; position++)
+	{
+		if (BLANK_PHRASE[position * 2] != '_')
+			continue;
+		unsigned int shown = SHOWN_MASK;
+		for (int letter = 0; shown != 0; letter++, shown >>= 1)
+		{
+			if ((shown & 1) == 0)
+				continue;
+			const size_t CELL = position * 26 + letter;
+			const uint32_t* const END = INDEX.cellWord.data() + INDEX.cellStart[CELL + 1];
+			for (const uint32_t* entry = lower_bound(INDEX.cellWord.data() + 
+				INDEX.cellStart[CELL], END, FIRST_WORD); 
+				entry != END && *entry < LAST_WORD; entry++)
+				matches.bits[*entry - FIRST_WORD] &= 
+					~INDEX.cellBits[entry - INDEX.cellWord.data()];
+		}
+	}
+
+	matches.count = countLeft();
+	return matches.count;
+}
+
+vector<int> matchingPhrases(const PatternIndex& INDEX, const PatternMatches& MATCHES)
+{
+	vector<int> phrases;
+	phrases.reserve(MATCHES.count);
+	for (size_t word = 0; word < MATCHES.bits.size(); word++)
+		for (uint64_t left = MATCHES.bits[word]; left != 0; left &= left - 1)
+			phrases.push_back(INDEX.byShape[(MATCHES.firstWord + word) * 64 + 
+				__builtin_ctzll(left)]);
+	return phrases;
+}
+
+void showHint(string& frame, const PatternIndex& INDEX, const Game& GAME)
+{
+	PatternMatches matches;
+	const int COUNT = queryPattern(INDEX, GAME.reveal.blankPhrase, 
+		GAME.guess[1].charGuesses, matches);
+
+	//Count the matches with each unguessed letter straight from the bits.
+	int best = -1, bestCount = 0;
+	for (int letter = 0; letter < 26; letter++)
+	{
+		if (GAME.guess[2].letterMask & (1u << letter))
+			continue;
+		int with = 0;
+		for (size_t word = 0; word < matches.bits.size(); word++)
+			with += static_cast<int>(bitset<64>(matches.bits[word] & 
+				INDEX.letterBits[letter * INDEX.words + matches.firstWord + word]).count());
+		if (with > bestCount)
+		{
+			best = letter;
+			bestCount = with;
+		}
+	}
+
+	frame += to_string(COUNT) + (COUNT == 1 ? " phrase fits." : " phrases fit.");
+	if (best >= 0)
+	{
+		frame += " Try '";
+		frame += static_cast<char>('a' + best);
+		frame += "'.";
+	}
+	frame += '\n';
+}
+
+Telemetry& telemetry()
+{
+	static Telemetry stats;
+	static const bool STARTED = []
+	{
+		const char* const FILE_NAME = getenv("HANGMAN_TELEMETRY");
+		if (FILE_NAME && *FILE_NAME)
+		{
+			stats.fileName = FILE_NAME;
+			stats.enabled = true;
+			atexit([] { writeTelemetry(telemetry().fileName); });
+		}
+		return true;
+	}();
+	(void)STARTED;
+	return stats;
+}
+
+TelemetryShard& telemetryShard()
+{
+	thread_local TelemetryShard* shard = nullptr;
+	if (!shard)
+	{
+		//Put the new shard at the front of the list.
+		Telemetry& stats = telemetry();
+		shard = new TelemetryShard;
+		shard->next = stats.shards.load(memory_order_relaxed);
+		while (!stats.shards.compare_exchange_weak(shard->next, shard, 
+			memory_order_release, memory_order_relaxed))
+			;
+	}
+	return *shard;
+}
+
+void bumpCounter(atomic<uint64_t>& counter)
+{
+	counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+void recordLatency(atomic<uint64_t> buckets[], const chrono::nanoseconds TIME)
+{
+	const uint64_t NANOS = static_cast<uint64_t>(max<long long>(TIME.count(), 1));
+	bumpCounter(buckets[min(63 - __builtin_clzll(NANOS), LATENCY_BUCKETS - 1)]);
+}
+
+void recordStep(const TimedStep STEP, const chrono::steady_clock::time_point START)
+{
+	Telemetry& stats = telemetry();
+	stats.stepNanos[STEP].fetch_add(static_cast<uint64_t>(
+		chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now() - START).count()), memory_order_relaxed);
+	stats.stepCalls[STEP].fetch_add(1, memory_order_relaxed);
+}
+
+void sizeTelemetry(const Corpus& CORPUS)
+{
+	Telemetry& stats = telemetry();
+	const size_t PHRASE_NUM = static_cast<size_t>(CORPUS.phraseNum);
+	stats.corpus = &CORPUS;
+	stats.plays = vector<atomic<uint32_t>>(PHRASE_NUM);
+	stats.wins = vector<atomic<uint32_t>>(PHRASE_NUM);
+	stats.misses = vector<atomic<uint32_t>>(PHRASE_NUM);
+	stats.letters.assign(CORPUS.counts, CORPUS.counts + PHRASE_NUM);
+}
+
+bool writeTelemetry(const string FILE_NAME)
+{
+	const char* const STEP_NAMES[TIMED_STEPS] = {"load_text", "load_compiled", 
+		"sort_phrases"};
+	Telemetry& stats = telemetry();
+	uint64_t results[LOST + 1] = {0};
+	uint64_t guessLatency[LATENCY_BUCKETS] = {0}, turnLatency[LATENCY_BUCKETS] = {0};
+
+	//Add up every thread's shard.
+	for (const TelemetryShard* shard = stats.shards.load(memory_order_acquire); 
+		shard; shard = shard->next)
+	{
+		for (int result = HIT; result <= LOST; result++)
+			results[result] += shard->results[result].load(memory_order_relaxed);
+		for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		{
+			guessLatency[bucket] += shard->guessLatency[bucket].load(memory_order_relaxed);
+			turnLatency[bucket] += shard->turnLatency[bucket].load(memory_order_relaxed);
+		}
+	}
+
+	ofstream fileOut(FILE_NAME);
+	if (!fileOut)
+		return false;
+
+	//Each step's calls and total time.
+	fileOut << fixed << setprecision(3);
+	for (int step = 0; step < TIMED_STEPS; step++)
+		fileOut << "step " << STEP_NAMES[step] << ' ' 
+			<< stats.stepCalls[step].load(memory_order_relaxed) << ' '
+			<< stats.stepNanos[step].load(memory_order_relaxed) / 1e6 << " ms\n";
+
+	//How many guesses had each result.
+	for (int result = HIT; result <= LOST; result++)
+		fileOut << "result " << convertGuessResult(static_cast<GuessResult>(result)) 
+			<< ' ' << results[result] << '\n';
+
+	//The histograms as the bottom of each bucket in ns and its count.
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		if (guessLatency[bucket] != 0)
+			fileOut << "guess_ns " << (1ull << bucket) << ' ' << guessLatency[bucket] << '\n';
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		if (turnLatency[bucket] != 0)
+			fileOut << "turn_ns " << (1ull << bucket) << ' ' << turnLatency[bucket] << '\n';
+
+	//Every phrase that was played, by its index in the corpus, with the
+	//letters it needs so its tier can be checked against how it went.
+	//Blank lines aren't phrases, so the index isn't always the line.
+	fileOut << "# phrase index letters plays wins misses\n";
+	for (size_t phrase = 0; phrase < stats.plays.size(); phrase++)
+	{
+		const uint32_t PLAYS = stats.plays[phrase].load(memory_order_relaxed);
+		if (PLAYS == 0)
+			continue;
+		fileOut << "phrase " << phrase << ' ' << static_cast<int>(stats.letters[phrase])
+			<< ' ' << PLAYS << ' ' << stats.wins[phrase].load(memory_order_relaxed)
+			<< ' ' << stats.misses[phrase].load(memory_order_relaxed) << '\n';
+	}
+
+	return static_cast<bool>(fileOut);
+}
+
+ReplayLog& replayLog()
+{
+	static ReplayLog replay;
+	static const bool STARTED = []
+	{
+		const char* const FILE_NAME = getenv("HANGMAN_REPLAY");
+		if (FILE_NAME && *FILE_NAME)
+		{
+			//A new log starts with the magic, an old one is added to.
+			error_code error;
+			const bool FRESH = filesystem::file_size(FILE_NAME, error) == 0 || error;
+			replay.file = fopen(FILE_NAME, "ab");
+			if (!replay.file)
+				cout << "Could not open replay log " << FILE_NAME << endl;
+			else
+			{
+				if (FRESH)
+					fwrite(REPLAY_MAGIC, 1, sizeof(REPLAY_MAGIC), replay.file);
+				replay.enabled = true;
+				replay.writer = thread(writeReplayBatches, ref(replay));
+			}
+		}
+		return true;
+	}();
+	(void)STARTED;
+	return replay;
+}
+
+ReplayLog::~ReplayLog()
+{
+	//Let the writer finish what is pending before closing the log.
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	if (writer.joinable())
+		writer.join();
+	if (file)
+		fclose(file);
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+	handOverReplay(bytes);
+}
+
+void writeReplayBatches(ReplayLog& log)
+{
+	vector<string> batches;
+	unique_lock<mutex> guard(log.lock);
+
+	while (true)
+	{
+		log.wake.wait(guard, [&log] { return log.stopping || !log.pending.empty(); });
+		if (log.pending.empty())
+			return;
+
+		//Take every batch waiting so far, and let threads add more while
+		//these are written.
+		batches.swap(log.pending);
+		guard.unlock();
+
+		//Every batch in the group shares the one sync.
+		for (const string& BATCH : batches)
+			fwrite(BATCH.data(), 1, BATCH.length(), log.file);
+		fflush(log.file);
+#ifdef __linux__
+		fdatasync(fileno(log.file));
+#endif
+		batches.clear();
+		guard.lock();
+	}
+}
+
+void handOverReplay(string& bytes)
+{
+	if (bytes.empty())
+		return;
+
+	ReplayLog& replay = replayLog();
+	{
+		lock_guard<mutex> guard(replay.lock);
+		replay.pending.push_back(move(bytes));
+	}
+	replay.wake.notify_one();
+	bytes.clear();
+}
+
+void logGame(const Game& GAME, const bool WON)
+{
+	const RevealState& REVEAL = GAME.reveal;
+
+	//Every other character of the blank phrase is the phrase, with the
+	//letters put back where they go.
+	string text((REVEAL.blankPhrase.length() + 1) / 2, ' ');
+	for (size_t index = 0; index < text.length(); index++)
+		text[index] = REVEAL.blankPhrase[index * 2];
+	for (size_t slot = 0; slot < REVEAL.positions.size(); slot++)
+		text[REVEAL.positions[slot] / 2] = REVEAL.letters[slot];
+
+	appendReplay(static_cast<uint32_t>(GAME.phraseIndex), 
+		static_cast<uint32_t>(contentHash(text)), GAME.seed, 
+		GAME.guess[2].charGuesses, WON);
+}
+
+void logCompactGame(const Corpus& CORPUS, const CompactGame& GAME, 
+	const GuessHistory& HISTORY, const uint64_t SEED, const bool WON)
+{
+	string guesses(GAME.guesses, ' ');
+
+	//Unpack the letters 5 bits at a time, some straddle two words.
+	for (unsigned int guess = 0; guess < GAME.guesses; guess++)
+	{
+		const unsigned int SHIFT = guess * 5;
+		uint64_t letter = HISTORY.bits[SHIFT / 64] >> (SHIFT % 64);
+		if (SHIFT % 64 > 59)
+			letter |= HISTORY.bits[SHIFT / 64 + 1] << (64 - SHIFT % 64);
+		guesses[guess] = static_cast<char>('a' + (letter & 31));
+	}
+
+	appendReplay(GAME.phraseIndex, static_cast<uint32_t>(contentHash(
+		phraseText(CORPUS, static_cast<int>(GAME.phraseIndex)))), SEED, guesses, WON);
+}
+
+void appendReplay(const uint32_t PHRASE, const uint32_t CHECK, const uint64_t SEED,
+	const string_view GUESSES, const bool WON)
+{
+	ReplayBuffer& buffer = replayBuffer();
+	const auto NOW = chrono::steady_clock::now();
+
+	//The fixed part of the record.
+	char record[REPLAY_FIXED + 17];
+	memcpy(record, &PHRASE, sizeof(PHRASE));
+	memcpy(record + 4, &CHECK, sizeof(CHECK));
+	memcpy(record + 8, &SEED, sizeof(SEED));
+	record[16] = static_cast<char>(GUESSES.length() | (WON ? 0x80 : 0));
+
+	//Pack the guesses 5 bits at a time as the letter's number.
+	size_t length = REPLAY_FIXED;
+	uint32_t bits = 0;
+	int held = 0;
+	for (const char GUESS : GUESSES)
+	{
+		bits |= static_cast<uint32_t>(__builtin_ctz(letterBit(GUESS))) << held;
+		held += 5;
+		for (; held >= 8; held -= 8, bits >>= 8)
+			record[length++] = static_cast<char>(bits);
+	}
+	if (held > 0)
+		record[length++] = static_cast<char>(bits);
+
+	if (buffer.bytes.empty())
+		buffer.since = NOW;
+	buffer.bytes.append(record, length);
+	if (buffer.bytes.length() >= REPLAY_BATCH || NOW - buffer.since >= REPLAY_WAIT)
+		handOverReplay(buffer.bytes);
+}
+
+ReplayBuffer& replayBuffer()
+{
+	thread_local ReplayBuffer buffer;
+	return buffer;
+}
+
+bool flushStaleReplay(const chrono::steady_clock::time_point NOW)
+{
+	ReplayBuffer& buffer = replayBuffer();
+	if (!buffer.bytes.empty() && NOW - buffer.since >= REPLAY_WAIT)
+		handOverReplay(buffer.bytes);
+	return !buffer.bytes.empty();
+}
+
+bool replayGames(const Corpus& CORPUS, const string FILE_NAME)
+{
+	long long games[INVALID_DIFFICULTY] = {0}; //Games replayed, by level
+	long long wins[INVALID_DIFFICULTY] = {0}; //Games won, by level
+	long long guesses[INVALID_DIFFICULTY] = {0}; //Letters guessed, by level
+	long long misses[INVALID_DIFFICULTY] = {0}; //Wrong letters, by level
+	long long firstGuesses[26] = {0}; //Games opened with each letter
+	long long changed = 0; //Records whose phrase isn't in the corpus anymore
+	long long different = 0; //Records that don't play out as logged
+	vector<uint8_t> levels(static_cast<size_t>(CORPUS.phraseNum), HARD);
+	vector<char> buffer(1 << 20);
+	size_t begin = 0, end = 0;
+	char magic[sizeof(REPLAY_MAGIC)];
+
+	ifstream fileIn(FILE_NAME, ios::binary);
+	if (!fileIn)
+	{
+		cout << "Could not open replay log " << FILE_NAME << endl;
+		return false;
+	}
+	if (!fileIn.read(magic, sizeof(magic)) || 
+		memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0)
+	{
+		cout << FILE_NAME << " is not a replay log" << endl;
+		return false;
+	}
+
+	//The level of every phrase, from where it is in the index.
+	for (int diff = EASY; diff < INVALID_DIFFICULTY; diff++)
+		for (int rank = CORPUS.index.tierStart[diff]; 
+			rank < CORPUS.index.tierStart[diff + 1]; rank++)
+			levels[CORPUS.index.order[rank]] = static_cast<uint8_t>(diff);
+
+	//Makes sure NEED bytes are in the buffer, reading more if they aren't.
+	const auto FILL = [&](const size_t NEED)
+	{
+		if (end - begin < NEED)
+		{
+			memmove(buffer.data(), buffer.data() + begin, end - begin);
+			end -= begin;
+			begin = 0;
+			fileIn.read(buffer.data() + end, static_cast<streamsize>(buffer.size() - end));
+			end += static_cast<size_t>(fileIn.gcount());
+		}
+		return end - begin >= NEED;
+	};
+
+	const auto START = chrono::steady_clock::now();
+	bool damaged = false;
+	while (FILL(REPLAY_FIXED))
+	{
+		const char* record = buffer.data() + begin;
+		uint32_t phrase, check;
+		memcpy(&phrase, record, sizeof(phrase));
+		memcpy(&check, record + 4, sizeof(check));
+		const unsigned int COUNT = static_cast<unsigned char>(record[16]) & 0x7f;
+		const bool LOGGED_WIN = (static_cast<unsigned char>(record[16]) & 0x80) != 0;
+		const size_t SIZE = REPLAY_FIXED + (COUNT * 5 + 7) / 8;
+		if (COUNT > 26 || !FILL(SIZE))
+		{
+			damaged = true;
+			break;
+		}
+		record = buffer.data() + begin;
+		begin += SIZE;
+
+		//The phrase has to be the same one that was played.
+		if (phrase >= static_cast<uint32_t>(CORPUS.phraseNum) || check != 
+			static_cast<uint32_t>(contentHash(phraseText(CORPUS, static_cast<int>(phrase)))))
+		{
+			changed++;
+			continue;
+		}
+
+		//Play the guesses back without counting them again.
+		Game game = startGame(CORPUS, static_cast<int>(phrase));
+		uint32_t bits = 0;
+		int held = 0;
+		const char* packed = record + REPLAY_FIXED;
+		for (unsigned int guess = 0; guess < COUNT && !gameOver(game); guess++)
+		{
+			if (held < 5)
+			{
+				bits |= static_cast<uint32_t>(static_cast<unsigned char>(*packed++)) << held;
+				held += 8;
+			}
+			const char LETTER = static_cast<char>('a' + (bits & 31));
+			bits >>= 5;
+			held -= 5;
+			if (guess == 0 && LETTER <= 'z')
+				firstGuesses[LETTER - 'a']++;
+			checkGuess(LETTER, game.phraseMask, game.guess, game.reveal);
+		}
+
+		const bool WON = checkVictory(game.reveal);
+		if (!gameOver(game) || WON != LOGGED_WIN || game.guess[2].numOfGuesses != COUNT)
+		{
+			different++;
+			continue;
+		}
+
+		const int LEVEL = levels[phrase];
+		games[LEVEL]++;
+		wins[LEVEL] += WON;
+		guesses[LEVEL] += COUNT;
+		misses[LEVEL] += game.guess[1].numOfGuesses;
+	}
+	damaged = damaged || begin != end;
+
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
+	const long long TOTAL = games[EASY] + games[MEDIUM] + games[HARD];
+
+	//Show the report, with every level on its own line.
+	cout << fixed << setprecision(2);
+	cout << "Games:            " << TOTAL << endl;
+	cout << "Changed phrases:  " << changed << endl;
+	cout << "Played out wrong: " << different << endl;
+	for (int diff = EASY; diff < INVALID_DIFFICULTY; diff++)
+	{
+		const double GAMES = static_cast<double>(max(games[diff], 1ll));
+		cout << left << setw(18) << convertDifficulty(static_cast<DifficultyLevel>(diff)) + ":"
+			<< right << games[diff] << " games, " << 100.0 * wins[diff] / GAMES 
+			<< "% won, " << guesses[diff] / GAMES << " guesses and " 
+			<< misses[diff] / GAMES << " misses per game" << endl;
+	}
+
+	//The five letters games opened with the most.
+	cout << "First guesses:   ";
+	int letters[26];
+	for (int letter = 0; letter < 26; letter++)
+		letters[letter] = letter;
+	partial_sort(letters, letters + 5, letters + 26, [&firstGuesses](int a, int b)
+		{ return firstGuesses[a] > firstGuesses[b]; });
+	for (int rank = 0; rank < 5 && firstGuesses[letters[rank]] > 0; rank++)
+		cout << ' ' << static_cast<char>('a' + letters[rank]) << ' ' 
+			<< 100.0 * firstGuesses[letters[rank]] / max(TOTAL + different, 1ll) << '%';
+	cout << endl;
+	cout << "Games per second: " << (TOTAL + changed + different) / max(SECONDS, 1e-9) << endl;
+	cout.unsetf(ios::floatfield);
+
+	if (damaged)
+		cout << "The last record in " << FILE_NAME << " is cut off" << endl;
+	return !damaged;
+}
+
+bool runBatch(const Corpus& CORPUS, const string FILE_NAME)
+{
+	const size_t CHUNK = 1 << 20; //Bytes read or written at a time
+	const char* const RESULT_WORDS[3] = {" WON ", " LOST ", " OPEN "};
+	vector<char> in(CHUNK), out;
+	size_t held = 0; //Bytes in in, from a line that isn't finished yet
+	long long games = 0, guesses = 0, bad = 0;
+
+	FILE* const FILE_IN = FILE_NAME == "-" ? stdin : fopen(FILE_NAME.c_str(), "rb");
+	if (!FILE_IN)
+	{
+		cerr << "Could not open " << FILE_NAME << endl;
+		return false;
+	}
+	out.reserve(CHUNK + 64);
+
+	const auto START = chrono::steady_clock::now();
+	bool more = true;
+	while (more)
+	{
+		//Fill the rest of the buffer, growing it for a line that doesn't fit.
+		if (held == in.size())
+			in.resize(in.size() * 2);
+		const size_t READ = fread(in.data() + held, 1, in.size() - held, FILE_IN);
+		const size_t END = held + READ;
+		more = READ > 0;
+
+		//Play every full line, and the last one once the input ends.
+		size_t start = 0;
+		while (start < END)
+		{
+			const char* const LINE = in.data() + start;
+			const char* newline = static_cast<const char*>(
+				memchr(LINE, '\n', END - start));
+			if (!newline && more)
+				break;
+			const size_t LENGTH = newline ? static_cast<size_t>(newline - LINE) : END - start;
+			start += LENGTH + 1;
+
+			//The phrase index, then the guesses after the spaces.
+			uint32_t phrase = 0;
+			const auto [AFTER, ERROR] = from_chars(LINE, LINE + LENGTH, phrase);
+			size_t guess = static_cast<size_t>(AFTER - LINE);
+			while (guess < LENGTH && (LINE[guess] == ' ' || LINE[guess] == '\t'))
+				guess++;
+			size_t last = LENGTH;
+			if (last > guess && LINE[last - 1] == '\r')
+				last--;
+			if (last == 0)
+				continue;
+			if (ERROR != errc() || phrase >= static_cast<uint32_t>(CORPUS.phraseNum))
+			{
+				//Echo the first word of the line so it can be found.
+				size_t word = 0;
+				while (word < last && LINE[word] != ' ' && LINE[word] != '\t')
+					word++;
+				out.insert(out.end(), LINE, LINE + word);
+				const string_view INVALID = " INVALID\n";
+				out.insert(out.end(), INVALID.begin(), INVALID.end());
+				bad++;
+			}
+			else
+			{
+				//Play until the guesses or the game run out.
+				const unsigned int PHRASE_MASK = CORPUS.masks[phrase];
+				CompactGame game = startCompactGame(static_cast<int>(phrase));
+				GuessResult result = HIT;
+				for (; guess < last && result != WON && result != LOST; guess++)
+					result = checkCompactGuess(game, PHRASE_MASK, LINE[guess]);
+				if (game.correctMask == PHRASE_MASK)
+					result = WON;
+				games++;
+				guesses += game.guesses;
+
+				//The result line, with the numbers written straight into it.
+				char line[48];
+				char* end = to_chars(line, line + 12, phrase).ptr;
+				const char* const WORD = 
+					RESULT_WORDS[result == WON ? 0 : result == LOST ? 1 : 2];
+				end = copy(WORD, WORD + strlen(WORD), end);
+				end = to_chars(end, end + 12, game.misses).ptr;
+				*end++ = ' ';
+				end = to_chars(end, end + 12, game.guesses).ptr;
+				*end++ = '\n';
+				out.insert(out.end(), line, end);
+			}
+			if (out.size() >= CHUNK)
+			{
+				fwrite(out.data(), 1, out.size(), stdout);
+				out.clear();
+			}
+		}
+
+		//Keep the start of an unfinished line for the next read.
+		held = start < END ? END - start : 0;
+		memmove(in.data(), in.data() + END - held, held);
+	}
+	fwrite(out.data(), 1, out.size(), stdout);
+	fflush(stdout);
+	if (FILE_IN != stdin)
+		fclose(FILE_IN);
+
+	//The summary goes to stderr so the results can be piped on.
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
+	cerr << fixed << setprecision(2) << "Played " << games << " games and " << guesses 
+		<< " guesses in " << SECONDS * 1000 << " ms, " 
+		<< guesses / max(SECONDS, 1e-9) / 1e6 << " million guesses per second";
+	if (bad > 0)
+		cerr << ", " << bad << " lines had no phrase";
+	cerr << endl;
+	return true;
+}
+
+void solveCorpus(const Corpus& CORPUS, const Solver& SOLVER)
+{
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	long long wins = 0; //Games the solver won
+	long long guesses = 0; //Letters the solver guessed
+	long long misses = 0; //Letters that weren't in the phrase
+	long long overBudget = 0; //Guesses that took longer than the budget
+	chrono::nanoseconds slowest(0); //Longest time for a single guess
+
+	const auto START = chrono::steady_clock::now();
+
+	//Play every phrase once.
+	for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+	{
+		Game game = startGame(CORPUS, phrase);
+		SolverGame solverGame = startSolverGame(SOLVER, game);
+		GuessResult result = HIT;
+
+		while (!gameOver(game))
+		{
+			//Time how long the solver takes to pick.
+			const auto PICK_START = chrono::steady_clock::now();
+			const char GUESS = pickGuess(SOLVER, solverGame, game);
+			const auto TAKEN = chrono::steady_clock::now() - PICK_START;
+
+			slowest = max(slowest, chrono::duration_cast<chrono::nanoseconds>(TAKEN));
+			if (SOLVER.budget.count() > 0 && TAKEN > SOLVER.budget)
+				overBudget++;
+
+			result = playGuess(game, GUESS);
+			guesses++;
+		}
+
+		misses += game.guess[1].numOfGuesses;
+		if (result == WON)
+			wins++;
+	}
+
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
+
+	//Show the report.
+	cout << fixed << setprecision(2);
+	cout << "Strategy:         " << (SOLVER.strategy == FREQUENCY ? 
+		"frequency" : "elimination") << endl;
+	cout << "Games:            " << PHRASE_NUM << endl;
+	cout << "Win rate:         " << 100.0 * wins / PHRASE_NUM << "%" << endl;
+	cout << "Guesses per game: " << static_cast<double>(guesses) / PHRASE_NUM << endl;
+	cout << "Misses per game:  " << static_cast<double>(misses) / PHRASE_NUM << endl;
+	cout << "Slowest guess:    " << slowest.count() / 1000.0 << " us" << endl;
+	cout << "Over budget:      " << overBudget << " of " << guesses << " guesses" << endl;
+	cout << "Games per second: " << PHRASE_NUM / SECONDS << endl;
+	cout.unsetf(ios::floatfield);
+}
+
+SolverStrategy convertStrategy(const string NAME)
+{
+	if (NAME == "frequency")
+		return FREQUENCY;
+	return ELIMINATION;
+}
+
+Random seedRandom(const uint64_t SEED, const uint64_t STREAM)
+{
+	Random rng;
+
+	//Spread the stream out so nearby streams start far apart.
+	rng.state = SEED;
+	rng.state ^= STREAM * 0xD1B54A32D192ED03ull;
+	nextRandom(rng);
+	return rng;
+}
+
+uint64_t nextRandom(Random& rng)
+{
+	//SplitMix64: step the state, then scramble it.
+	uint64_t z = (rng.state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+unsigned int randomBelow(Random& rng, const unsigned int BOUND)
+{
+	//Scale the top 32 bits into the range instead of using %.
+	return static_cast<unsigned int>(((nextRandom(rng) >> 32) * BOUND) >> 32);
+}
+
+void simulateGames(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const long long GAMES, const uint64_t SEED, 
+	const unsigned int THREADS)
+{
+	//Games are numbered with 32 bits.
+	const uint32_t LAST = static_cast<uint32_t>(min(max(GAMES, 1ll), 
+		static_cast<long long>(UINT32_MAX)));
+
+	//Time a slice of the games on one thread to compare against.
+	const uint32_t SAMPLE = min(LAST, max(LAST / 10, min(LAST, 10000u)));
+	auto start = chrono::steady_clock::now();
+	runSimulation(CORPUS, INDEX, SOLVER, 0, SAMPLE, SEED, 1);
+	const double SINGLE_RATE = SAMPLE / chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+
+	//Play every game on every thread.
+	start = chrono::steady_clock::now();
+	const SimulationTotals TOTALS = runSimulation(CORPUS, INDEX, SOLVER,
+		0, LAST, SEED, THREADS);
+	const double RATE = LAST / chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+
+	//Show the report.
+	cout << fixed << setprecision(2);
+	cout << "Games:              " << TOTALS.games << endl;
+	cout << "Threads:            " << THREADS << endl;
+	cout << "Seed:               " << SEED << endl;
+	cout << "Win rate:           " << 100.0 * TOTALS.wins / TOTALS.games << "%" << endl;
+	cout << "Guesses per game:   " << static_cast<double>(TOTALS.guesses) / TOTALS.games << endl;
+	cout << "Misses per game:    " << static_cast<double>(TOTALS.misses) / TOTALS.games << endl;
+	cout << "Games per second:   " << RATE << endl;
+	cout << "One thread:         " << SINGLE_RATE << endl;
+	cout << "Scaling efficiency: " << 100.0 * RATE / (SINGLE_RATE * THREADS) << "%" << endl;
+	cout << "Checksum:           " << hex << setw(16) << setfill('0') << TOTALS.checksum 
+		<< dec << setfill(' ') << endl;
+	cout.unsetf(ios::floatfield);
+}
+
+SimulationTotals runSimulation(const Corpus& CORPUS, 
+	const DifficultyIndex& INDEX, const Solver& SOLVER, const uint32_t FIRST,
+	const uint32_t LAST, const uint64_t SEED, const unsigned int THREADS)
+{
+	const unsigned int WORKERS = max(THREADS, 1u);
+	vector<WorkRange> ranges(WORKERS);
+	vector<SimulationTotals> totals(WORKERS);
+	vector<thread> threads;
+	SimulationTotals sum;
+
+	//Split the games evenly to start with.
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+	{
+		const uint64_t BEGIN = FIRST + (uint64_t(LAST) - FIRST) * worker / WORKERS;
+		const uint64_t END = FIRST + (uint64_t(LAST) - FIRST) * (worker + 1) / WORKERS;
+		ranges[worker].range.store(BEGIN << 32 | END);
+	}
+
+	//Every worker plays games until there are none left to take. Its
+	//totals stay on its own stack until the end, so workers never write
+	//to the same cache line.
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+	{
+		threads.emplace_back([&, worker]()
+		{
+			SimulationTotals mine;
+			uint32_t first, last;
+			while (takeWork(ranges.data(), WORKERS, worker, first, last))
+				for (uint32_t game = first; game < last; game++)
+					simulateGame(CORPUS, INDEX, SOLVER, SEED, game, mine);
+			totals[worker] = mine;
+		});
+	}
+
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+		threads[worker].join();
+
+	//Adding up the totals doesn't depend on who played what.
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+	{
+		sum.games += totals[worker].games;
+		sum.wins += totals[worker].wins;
+		sum.guesses += totals[worker].guesses;
+		sum.misses += totals[worker].misses;
+		sum.checksum += totals[worker].checksum;
+	}
+	return sum;
+}
+
+bool takeWork(WorkRange ranges[], const unsigned int WORKERS, 
+	const unsigned int SELF, uint32_t& first, uint32_t& last)
+{
+	const uint32_t CHUNK = 64; //Games taken from a range at a time
+
+	//Take the next chunk from the front of this worker's own range.
+	uint64_t range = ranges[SELF].range.load();
+	while (static_cast<uint32_t>(range >> 32) < static_cast<uint32_t>(range))
+	{
+		first = static_cast<uint32_t>(range >> 32);
+		last = min(first + CHUNK, static_cast<uint32_t>(range));
+		if (ranges[SELF].range.compare_exchange_weak(range, 
+			uint64_t(last) << 32 | static_cast<uint32_t>(range)))
+			return true;
+	}
+
+	//Otherwise steal the back half of another worker's range.
+	for (unsigned int offset = 1; offset < WORKERS; offset++)
+	{
+		WorkRange& victim = ranges[(SELF + offset) % WORKERS];
+		range = victim.range.load();
+		while (static_cast<uint32_t>(range >> 32) < static_cast<uint32_t>(range))
+		{
+			const uint32_t BEGIN = static_cast<uint32_t>(range >> 32);
+			const uint32_t END = static_cast<uint32_t>(range);
+			const uint32_t MIDDLE = BEGIN + (END - BEGIN) / 2;
+
+			if (victim.range.compare_exchange_weak(range, uint64_t(BEGIN) << 32 | MIDDLE))
+			{
+				//Play the first chunk now and keep the rest to take from.
+				first = MIDDLE;
+				last = min(MIDDLE + CHUNK, END);
+				ranges[SELF].range.store(uint64_t(last) << 32 | END);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void simulateGame(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const uint64_t SEED, const uint32_t GAME_NUMBER,
+	SimulationTotals& totals)
+{
+	//Every game has its own stream, so it plays out the same everywhere.
+	Random rng = seedRandom(SEED, GAME_NUMBER);
+	const uint64_t DEAL = rng.state;
+
+	//Pick a difficulty, then a phrase from it.
+	const int DIFF = static_cast<int>(randomBelow(rng, INVALID_DIFFICULTY));
+	const int PHRASE = randomTierPhrase(INDEX, DIFF, rng);
+
+	//Let the solver play it out.
+	Game game = startGame(CORPUS, PHRASE);
+	game.seed = DEAL;
+	SolverGame solverGame = startSolverGame(SOLVER, game);
+	GuessResult result = HIT;
+	while (!gameOver(game))
+		result = playGuess(game, pickGuess(SOLVER, solverGame, game));
+
+	//Add the game to the totals, with a hash of its result in the checksum.
+	Random hash = seedRandom(GAME_NUMBER, uint64_t(PHRASE) << 16 | 
+		game.guess[2].numOfGuesses << 8 | game.guess[1].numOfGuesses << 1 | 
+		(result == WON));
+	totals.games++;
+	totals.wins += result == WON;
+	totals.guesses += game.guess[2].numOfGuesses;
+	totals.misses += game.guess[1].numOfGuesses;
+	totals.checksum += nextRandom(hash);
+}
+
+//Results of timed calls go here so the compiler can't skip them.
+volatile uint64_t benchSink = 0;
+
+bool runBenchmarks(const long long MAX_PHRASES, const string BASELINE_FILE)
+{
+	const int MIN_LENGTHS[2] = {8, 60}; //Shortest phrase of each profile
+	const int MAX_LENGTHS[2] = {24, 160}; //Longest phrase of each profile
+	const string LENGTHS[2] = {"short", "long"}; //Names of the profiles
+
+	vector<BenchResult> results;
+	Random rng = seedRandom(2024, 0);
+
+	//Corpora go up 100 times each step, then to the maximum.
+	vector<long long> sizes;
+	for (long long size = 100; size < MAX_PHRASES; size *= 100)
+		sizes.push_back(size);
+	sizes.push_back(max(MAX_PHRASES, 1ll));
+
+	for (size_t size = 0; size < sizes.size(); size++)
+	{
+		for (int profile = 0; profile < 2; profile++)
+		{
+			Corpus corpus;
+			makeSyntheticCorpus(sizes[size], MIN_LENGTHS[profile], 
+				MAX_LENGTHS[profile], rng, corpus);
+
+			//Small corpora go through each benchmark again until about a
+			//200,000 phrases have been timed. Keep the fastest of 3 runs.
+			const int REPEAT = static_cast<int>(max(200000 / sizes[size], 1ll));
+			const size_t FIRST = results.size();
+			benchCorpus(corpus, LENGTHS[profile], REPEAT, results);
+			for (int run = 1; run < 3; run++)
+			{
+				vector<BenchResult> again;
+				benchCorpus(corpus, LENGTHS[profile], REPEAT, again);
+				for (size_t index = 0; index < again.size(); index++)
+					results[FIRST + index].nsPerOp = min(results[FIRST + index].nsPerOp,
+						again[index].nsPerOp);
+			}
+		}
+	}
+
+	//Save the results where they can be kept as the next baseline.
+	ofstream fileOut("bench_output.txt");
+	fileOut << "benchmark,phrases,lengths,ns_per_op,ops\n";
+	for (size_t index = 0; index < results.size(); index++)
+		fileOut << results[index].name << ',' << results[index].phrases << ','
+			<< results[index].lengths << ',' << results[index].nsPerOp << ','
+			<< results[index].ops << '\n';
+	fileOut.close();
+
+	//Show the results.
+	cout << "Letter kernels: " << letterKernels().name << endl;
+	cout << setw(20) << left << "Benchmark" << setw(10) << right << "Phrases"
+		<< setw(8) << "Lengths" << setw(14) << "ns/op" << endl;
+	for (size_t index = 0; index < results.size(); index++)
+		cout << setw(20) << left << results[index].name << setw(10) << right 
+			<< results[index].phrases << setw(8) << results[index].lengths 
+			<< setw(14) << fixed << setprecision(2) << results[index].nsPerOp 
+			<< endl;
+	cout.unsetf(ios::floatfield);
+	cout << "Results written to bench_output.txt" << endl;
+
+	if (BASELINE_FILE.empty())
+		return false;
+	return compareBaseline(results, BASELINE_FILE);
+}
+
+void makeSyntheticCorpus(const long long COUNT, const int MIN_LENGTH,
+	const int MAX_LENGTH, Random& rng, Corpus& corpus)
+{
+	//Letters weighted roughly like English so masks look realistic.
+	const string LETTERS = "eeeeeeeeeeeettttttttaaaaaaaaooooooo"
+		"iiiiiiinnnnnnnsssssshhhhhhrrrrrrddddlllluuuccmmwwffggyyppbbvkjxqz";
+
+	string text; //Every line, like a text file
+	string line;
+	text.reserve(static_cast<size_t>(COUNT) * (MAX_LENGTH + 8));
+
+	for (long long phrase = 0; phrase < COUNT; phrase++)
+	{
+		const int LENGTH = MIN_LENGTH + static_cast<int>(randomBelow(rng, 
+			static_cast<unsigned int>(MAX_LENGTH - MIN_LENGTH + 1)));
+
+		//Words of 1 to 8 letters with a space between them.
+		line.clear();
+		while (static_cast<int>(line.length()) < LENGTH)
+		{
+			if (!line.empty())
+				line += ' ';
+			const unsigned int WORD = 1 + randomBelow(rng, 8);
+			for (unsigned int letter = 0; letter < WORD; letter++)
+				line += LETTERS[randomBelow(rng, 
+					static_cast<unsigned int>(LETTERS.length()))];
+		}
+
+		//Start each phrase with a capital letter like the real ones.
+		line[0] = static_cast<char>(line[0] - 32);
+		text += line;
+		text += '\n';
+	}
+
+	//Split it up the same way a loaded file is.
+	corpus.textArena.assign(text.begin(), text.end());
+	splitPhrases(corpus);
+}
+
+void benchCorpus(const Corpus& CORPUS, const string LENGTHS,
+	const int REPEAT, vector<BenchResult>& results)
+{
+	const int PHRASE_NUM = CORPUS.phraseNum;
+	const size_t BATCH = 4096; //Games set up at a time for checkGuess
+	const string GUESS_ORDER = "etaoinshrdlucmfwypvbgkjqxz";
+	uint64_t sink = 0;
+	long long ops = 0;
+
+	//Adds a result from a start time and the number of calls made.
+	auto record = [&](const string NAME, const chrono::steady_clock::time_point START,
+		const long long OPS)
+	{
+		const double NS = chrono::duration<double, nano>(
+			chrono::steady_clock::now() - START).count();
+		results.push_back({NAME, PHRASE_NUM, LENGTHS, NS / max(OPS, 1ll), OPS});
+	};
+
+	//uniqueLetterCount, from the text so the mask is built too.
+	auto start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+			sink += uniqueLetterCount(buildLetterMask(phraseText(CORPUS, phrase)));
+	record("uniqueLetterCount", start, 1ll * PHRASE_NUM * REPEAT);
+
+	//maybeUnique, on every character while the mask fills up.
+	ops = 0;
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+	{
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		{
+			const string_view TEXT = phraseText(CORPUS, phrase);
+			unsigned int mask = 0;
+			for (size_t index = 0; index < TEXT.length(); index++)
+				if (maybeUnique(mask, TEXT[index]))
+					mask |= letterBit(TEXT[index]);
+			sink += mask;
+			ops += TEXT.length();
+		}
+	}
+	record("maybeUnique", start, ops);
+
+	//phraseWithBlanks, with the common vowels guessed.
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+			sink += phraseWithBlanks(phraseText(CORPUS, phrase), "aeiou").length();
+	record("phraseWithBlanks", start, 1ll * PHRASE_NUM * REPEAT);
+
+	//withGuesses, every character against one guess.
+	ops = 0;
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+	{
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+		{
+			const string_view TEXT = phraseText(CORPUS, phrase);
+			for (size_t index = 0; index < TEXT.length(); index++)
+				sink += withGuesses(TEXT[index], 'e');
+			ops += TEXT.length();
+		}
+	}
+	record("withGuesses", start, ops);
+
+	//checkGuess and checkVictory, with the games set up outside the timing.
+	chrono::nanoseconds guessTime(0), victoryTime(0);
+	long long guessOps = 0, victoryOps = 0;
+	vector<Game> games;
+	for (int again = 0; again < REPEAT; again++)
+	{
+		for (size_t first = 0; first < static_cast<size_t>(PHRASE_NUM); first += BATCH)
+		{
+			const size_t LAST = min(first + BATCH, static_cast<size_t>(PHRASE_NUM));
+			games.clear();
+			for (size_t phrase = first; phrase < LAST; phrase++)
+				games.push_back(startGame(CORPUS, static_cast<int>(phrase)));
+
+			start = chrono::steady_clock::now();
+			for (size_t game = 0; game < games.size(); game++)
+				for (size_t letter = 0; letter < GUESS_ORDER.length(); letter++)
+					sink += checkGuess(GUESS_ORDER[letter], games[game].phraseMask,
+						games[game].guess, games[game].reveal);
+			guessTime += chrono::steady_clock::now() - start;
+			guessOps += static_cast<long long>(games.size() * GUESS_ORDER.length());
+
+			start = chrono::steady_clock::now();
+			for (size_t game = 0; game < games.size(); game++)
+				sink += checkVictory(games[game].reveal);
+			victoryTime += chrono::steady_clock::now() - start;
+			victoryOps += static_cast<long long>(games.size());
+		}
+	}
+	results.push_back({"checkGuess", PHRASE_NUM, LENGTHS, 
+		static_cast<double>(guessTime.count()) / max(guessOps, 1ll), guessOps});
+	results.push_back({"checkVictory", PHRASE_NUM, LENGTHS,
+		static_cast<double>(victoryTime.count()) / max(victoryOps, 1ll), victoryOps});
+
+	//sortPhrases, per phrase sorted.
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+		sink += sortPhrases(CORPUS).order.size();
+	record("sortPhrases", start, 1ll * PHRASE_NUM * REPEAT);
+
+	//queryPattern and matchingPhrases, on each phrase with the common
+	//letters guessed and the index built outside the timing.
+	{
+		const PatternIndex INDEX = buildPatternIndex(CORPUS);
+		PatternMatches matches;
+		vector<string> blanks(PHRASE_NUM);
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+			blanks[phrase] = phraseWithBlanks(phraseText(CORPUS, phrase), "etaoin");
+		start = chrono::steady_clock::now();
+		for (int again = 0; again < REPEAT; again++)
+		{
+			for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+			{
+				queryPattern(INDEX, blanks[phrase], "", matches);
+				sink += matchingPhrases(INDEX, matches).size();
+			}
+		}
+		record("queryPattern", start, 1ll * PHRASE_NUM * REPEAT);
+	}
+
+	//loadPhrasesFromFile, per phrase loaded, from a file of this corpus.
+	{
+		ofstream fileOut("bench_corpus.txt", ios::binary);
+		for (int phrase = 0; phrase < PHRASE_NUM; phrase++)
+			fileOut << phraseText(CORPUS, phrase) << '\n';
+	}
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+	{
+		Corpus loaded;
+		sink += loadPhrasesFromFile("bench_corpus.txt", loaded, false);
+	}
+	record("loadPhrasesFromFile", start, 1ll * PHRASE_NUM * REPEAT);
+
+	//loadCompiledCorpus, per phrase loaded, from the same file compiled.
+	{
+		streambuf* const OLD_OUT = cout.rdbuf(nullptr);
+		compileCorpus("bench_corpus.txt", "bench_corpus.hmc", false);
+		cout.rdbuf(OLD_OUT);
+	}
+	start = chrono::steady_clock::now();
+	for (int again = 0; again < REPEAT; again++)
+	{
+		Corpus loaded;
+		sink += loadCompiledCorpus("bench_corpus.hmc", loaded) ? 
+			loaded.phraseNum : 0;
+	}
+	record("loadCompiledCorpus", start, 1ll * PHRASE_NUM * REPEAT);
+	remove("bench_corpus.txt");
+	remove("bench_corpus.hmc");
+
+	benchSink = benchSink + sink;
+}
+
+bool compareBaseline(const vector<BenchResult>& RESULTS, const string BASELINE_FILE)
+{
+	const double SLOWER = 1.10; //How much slower counts as a regression
+
+	map<string, double> baseline; //ns/op from the baseline, by name,phrases,lengths
+	ifstream fileIn(BASELINE_FILE);
+	string line;
+	bool regressed = false;
+
+	if (fileIn.fail())
+	{
+		cout << "Baseline " << BASELINE_FILE << " does not exist" << endl;
+		return false;
+	}
+
+	//Skip the header, then read every result.
+	getline(fileIn, line);
+	while (getline(fileIn, line))
+	{
+		stringstream fields(line);
+		string name, phrases, lengths, nsPerOp;
+		getline(fields, name, ',');
+		getline(fields, phrases, ',');
+		getline(fields, lengths, ',');
+		getline(fields, nsPerOp, ',');
+		baseline[name + ',' + phrases + ',' + lengths] = atof(nsPerOp.c_str());
+	}
+
+	//Show the change for everything that is in both.
+	cout << endl << "Compared to " << BASELINE_FILE << ":" << endl;
+	for (size_t index = 0; index < RESULTS.size(); index++)
+	{
+		const auto FOUND = baseline.find(RESULTS[index].name + ',' + 
+			to_string(RESULTS[index].phrases) + ',' + RESULTS[index].lengths);
+		if (FOUND == baseline.end() || FOUND->second <= 0)
+			continue;
+
+		const double RATIO = RESULTS[index].nsPerOp / FOUND->second;
+		cout << setw(20) << left << RESULTS[index].name << setw(10) << right 
+			<< RESULTS[index].phrases << setw(8) << RESULTS[index].lengths 
+			<< setw(10) << showpos << fixed << setprecision(1) 
+			<< (RATIO - 1) * 100 << "%" << noshowpos;
+		if (RATIO > SLOWER)
+		{
+			cout << "  REGRESSION";
+			regressed = true;
+		}
+		cout << endl;
+	}
+	cout.unsetf(ios::floatfield);
+
+	return regressed;
+}
+
+int randomTierPhrase(const DifficultyIndex& INDEX, int diff, Random& rng)
+{
+	//Empty levels use the next harder one, the hardest is never empty.
+	while (INDEX.tierStart[diff] == INDEX.tierStart[diff + 1] && diff < HARD)
+		diff++;
+
+	return INDEX.order[INDEX.tierStart[diff] + static_cast<int>(
+		randomBelow(rng, static_cast<unsigned int>(
+		INDEX.tierStart[diff + 1] - INDEX.tierStart[diff])))];
+}
+
+string convertGuessResult(GuessResult result)
+{
+	string word;
+
+	switch (result)
+	{
+		case HIT:
+			word = "HIT";
+			break;
+		case MISS:
+			word = "MISS";
+			break;
+		case REPEAT:
+			word = "REPEAT";
+			break;
+		case INVALID_GUESS:
+			word = "INVALID";
+			break;
+		case WON:
+			word = "WON";
+			break;
+		default:
+			word = "LOST";
+	}
+	return word;
+}
+
+void handleRequest(ServerSession& session, const string& LINE,
+	const shared_ptr<const Corpus>& LATEST, SessionTable& table, Random& rng)
+{
+	//"new 1" to "new 3" starts a game, replying with its id and the
+	//blank phrase.
+	if (LINE.compare(0, 4, "new ") == 0 && LINE.length() == 5 &&
+		LINE[4] >= '1' && LINE[4] <= '3')
+	{
+		const uint64_t DEAL = rng.state;
+		const CompactGame GAME = startCompactGame(
+			randomTierPhrase(LATEST->index, LINE[4] - '1', rng));
+		session.gameId = storeGame(table, GAME, DEAL, LATEST);
+		if (session.gameId == 0)
+			session.out += "ERROR too many games, try again later\n";
+		else
+			session.out += "START " + to_string(session.gameId) + ' ' + 
+				compactBlanks(*LATEST, GAME) + '\n';
+	}
+
+	//"resume" and an id carries on with a game from another connection,
+	//replying with the misses and the blank phrase.
+	else if (LINE.compare(0, 7, "resume ") == 0)
+	{
+		const uint64_t GAME_ID = strtoull(LINE.c_str() + 7, nullptr, 10);
+		SessionShard& shard = sessionShard(table, GAME_ID);
+		lock_guard<mutex> guard(shard.lock);
+		const auto FOUND = shard.games.find(GAME_ID);
+		if (GAME_ID == 0 || FOUND == shard.games.end())
+			session.out += "ERROR no game with that id\n";
+		else
+		{
+			StoredGame& stored = FOUND->second;
+			stored.touched = chrono::steady_clock::now();
+			session.gameId = GAME_ID;
+			session.out += "RESUME " + to_string(stored.game.misses) + ' ' + 
+				compactBlanks(*stored.corpus, stored.game) + '\n';
+		}
+	}
+
+	//A single character is a guess. The reply is the result, the misses,
+	//and the blank phrase, or the whole phrase once the game is over.
+	else if (LINE.length() == 1 && session.gameId != 0)
+	{
+		SessionShard& shard = sessionShard(table, session.gameId);
+		lock_guard<mutex> guard(shard.lock);
+		const auto FOUND = shard.games.find(session.gameId);
+		if (FOUND == shard.games.end())
+		{
+			//Finished from another connection, or dropped for being idle.
+			session.out += "ERROR game is over, send new 1, new 2, or new 3\n";
+			session.gameId = 0;
+		}
+		else
+		{
+			StoredGame& stored = FOUND->second;
+			const GuessResult RESULT = playCompactGuess(stored.game, stored.history, 
+				*stored.corpus, LINE[0], stored.seed);
+			session.out += convertGuessResult(RESULT) + ' ' + 
+				to_string(stored.game.misses) + ' ';
+			if (RESULT == WON || RESULT == LOST)
+			{
+				session.out += phraseText(*stored.corpus, 
+					static_cast<int>(stored.game.phraseIndex));
+				shard.games.erase(FOUND);
+				session.gameId = 0;
+			}
+			else
+			{
+				session.out += compactBlanks(*stored.corpus, stored.game);
+				stored.touched = chrono::steady_clock::now();
+			}
+			session.out += '\n';
+		}
+	}
+
+	//"stats" writes the telemetry report now instead of at exit.
+	else if (LINE == "stats")
+	{
+		Telemetry& stats = telemetry();
+		if (!stats.enabled)
+			session.out += "ERROR telemetry is off, set HANGMAN_TELEMETRY\n";
+		else if (!writeTelemetry(stats.fileName))
+			session.out += "ERROR could not write " + stats.fileName + '\n';
+		else
+			session.out += "STATS " + stats.fileName + '\n';
+	}
+
+	else if (LINE.length() == 1)
+		session.out += "ERROR no game, send new 1, new 2, or new 3\n";
 	else
+		session.out += "ERROR unknown request\n";
+}
+
+SessionShard& sessionShard(SessionTable& table, const uint64_t GAME_ID)
+{
+	return table.shards[GAME_ID & (SESSION_SHARDS - 1)];
+}
+
+uint64_t storeGame(SessionTable& table, const CompactGame& GAME, const uint64_t SEED,
+	const shared_ptr<const Corpus>& CORPUS)
+{
+	const size_t SHARD_LIMIT = SESSION_LIMIT / SESSION_SHARDS;
+	const auto NOW = chrono::steady_clock::now();
+
+	//Ids can't be worked out from other ids, so players can't guess
+	//each other's.
+	const uint64_t gameId = randomGameId();
+
+	SessionShard& shard = sessionShard(table, gameId);
+	lock_guard<mutex> guard(shard.lock);
+
+	//A full shard makes room from its idle games before giving up.
+	if (shard.games.size() >= SHARD_LIMIT)
+		erase_if(shard.games, [&NOW](const auto& ENTRY) 
+			{ return NOW - ENTRY.second.touched >= SESSION_TTL; });
+	if (shard.games.size() >= SHARD_LIMIT || !shard.games.try_emplace(gameId, 
+		StoredGame{GAME, {}, SEED, CORPUS, NOW}).second)
+		return 0;
+	return gameId;
+}
+
+uint64_t randomGameId()
+{
+	const size_t BATCH = 64; //Ids fetched from the system at a time
+	thread_local uint64_t ids[BATCH];
+	thread_local size_t left = 0;
+
+	uint64_t gameId = 0;
+	while (gameId == 0)
 	{
-		for (unsigned int index = 0; index < UNIQ_CHARS.length(); index++)
+		//Fetch a batch at a time so most ids don't cost a system call.
+		if (left == 0)
 		{
-			//if the lowercase value is already in uniqChars
-			if (ch == UNIQ_CHARS[index])
-				return false;
+#ifdef __linux__
+			size_t filled = 0;
+			while (filled < sizeof(ids))
+			{
+				const ssize_t BYTES = getrandom(reinterpret_cast<char*>(ids) + filled, 
+					sizeof(ids) - filled, 0);
+				if (BYTES > 0)
+					filled += static_cast<size_t>(BYTES);
+				else if (errno != EINTR)
+					terminate();
+			}
+#else
+			random_device device;
+			for (uint64_t& id : ids)
+				id = uint64_t(device()) << 32 | device();
+#endif
+			left = BATCH;
 		}
+		gameId = ids[--left];
 	}
-	//character is eligible after being converted to lowercase, and
-	//wasn't found in the UNIQ_CHARS string.
-	return true;
+	return gameId;
 }
 
-//PASSED, DON'T TOUCH
-int uniqueLetterCount(const string SINGLE_PHRASE)
-{
-    char ch; //Holds value of current character to test against holdChar
-	string holdChar = " "; //Holds the unique Characters
-	bool uniq = true; //Is true if character is unique.
-
-    //Outer loop to go through each value
-    for(unsigned int index = 0; index < SINGLE_PHRASE.length(); index++)
-    {
-		//set ch to character value of the phrase at the index
-		ch = SINGLE_PHRASE[index];
-
-		//used to test ch character values against that of holdChar
-		for (unsigned int iter = 0; iter < holdChar.length(); iter++)
-		{	
-			//if the character equals anything in the held characters,
-			//it is not unique.
-			if (ch == holdChar[iter])
+void evictSessions(SessionTable& table, const unsigned int FIRST, 
+	const unsigned int STEP, const chrono::steady_clock::time_point NOW)
+{
+	for (unsigned int index = FIRST; index < SESSION_SHARDS; index += STEP)
+	{
+		SessionShard& shard = table.shards[index];
+		lock_guard<mutex> guard(shard.lock);
+		erase_if(shard.games, [&NOW](const auto& ENTRY) 
+			{ return NOW - ENTRY.second.touched >= SESSION_TTL; });
+	}
+}
+
+#if __cpp_impl_coroutine < 201902L
+void interleaveGames(const Corpus&, const DifficultyIndex&, const Solver&, 
+	const long long, const uint64_t)
+{
+	cout << "Interleaved games need a compiler with C++20 coroutines." << endl;
+}
+#else
+void interleaveGames(const Corpus& CORPUS, const DifficultyIndex& INDEX,
+	const Solver& SOLVER, const long long GAMES, const uint64_t SEED)
+{
+	vector<GameTask> tasks; //Games still in progress
+	vector<SolverGame> solverGames; //The solver's state for each of them
+	Random rng = seedRandom(SEED, 0);
+	long long wins = 0, guesses = 0;
+
+	const auto START = chrono::steady_clock::now();
+
+	//Start every game, each one suspends until its first guess. A phrase
+	//without letters is already won, so it never waits for one.
+	tasks.reserve(static_cast<size_t>(max(GAMES, 0ll)));
+	solverGames.reserve(tasks.capacity());
+	for (long long game = 0; game < GAMES; game++)
+	{
+		const int DIFF = static_cast<int>(randomBelow(rng, INVALID_DIFFICULTY));
+		GameTask task = playGameTask(CORPUS, randomTierPhrase(INDEX, DIFF, rng));
+		if (taskDone(task))
+		{
+			wins += task.handle.promise().result == WON;
+			continue;
+		}
+		solverGames.push_back(startSolverGame(SOLVER, taskGame(task)));
+		tasks.push_back(move(task));
+	}
+	const size_t PEAK = tasks.size();
+
+	//Give every game in progress its next guess, round and round, and
+	//drop the games that finish by moving the last one into their spot.
+	while (!tasks.empty())
+	{
+		for (size_t index = 0; index < tasks.size(); )
+		{
+			const char GUESS = pickGuess(SOLVER, solverGames[index], taskGame(tasks[index]));
+			const GuessResult RESULT = resumeGame(tasks[index], GUESS);
+			guesses++;
+
+			if (!taskDone(tasks[index]))
 			{
-				uniq = false;
+				index++;
+				continue;
 			}
-		} //end inner loop
 
-		//if the unique bool remained true, check validity of the ch.
-		//add the ch value to the string that holds unique characters.
-		if (uniq && maybeUnique(holdChar, ch))
-			holdChar += ch;
-		
-		//Assume that every new character is unique until proven otherwise.
-		uniq = true;
+			wins += RESULT == WON;
+			tasks[index] = move(tasks.back());
+			tasks.pop_back();
+			solverGames[index] = move(solverGames.back());
+			solverGames.pop_back();
+		}
+	}
+
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
+
+	//Show the report.
+	cout << fixed << setprecision(2);
+	cout << "Games:             " << GAMES << endl;
+	cout << "Most at once:      " << PEAK << endl;
+	cout << "Frame size:        " << sizeof(GameTask::promise_type) << "+ bytes" << endl;
+	cout << "Win rate:          " << 100.0 * wins / max(GAMES, 1ll) << "%" << endl;
+	cout << "Guesses per game:  " << static_cast<double>(guesses) / max(GAMES, 1ll) << endl;
+	cout << "Games per second:  " << GAMES / SECONDS << endl;
+	cout << "Guesses per second: " << guesses / SECONDS << endl;
+	cout.unsetf(ios::floatfield);
+}
+
+GameTask playGameTask(const Corpus& CORPUS, const int PHRASE_INDEX)
+{
+	GameTask::promise_type& promise = co_await GameTask::GetPromise{};
+	promise.game = startGame(CORPUS, PHRASE_INDEX);
+	promise.result = gameOver(promise.game) ? WON : HIT;
+
+	//Wait for each guess, then play it.
+	while (!gameOver(promise.game))
+		promise.result = playGuess(promise.game, co_await GameTask::NextGuess{});
+}
+
+GameTask GameTask::promise_type::get_return_object()
+{
+	return GameTask{coroutine_handle<promise_type>::from_promise(*this)};
+}
+
+GameTask& GameTask::operator=(GameTask&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (handle)
+			handle.destroy();
+		handle = other.handle;
+		other.handle = nullptr;
+	}
+	return *this;
+}
 
-    } //End outer loop
+GameTask::~GameTask()
+{
+	if (handle)
+		handle.destroy();
+}
 
-	//Erase the space that holdChar is initialized to.
-	holdChar.erase(0, 1);
+void* GameTask::promise_type::operator new(size_t size)
+{
+	FramePool& spare = spareFrames();
 
-    return holdChar.length();
-} //End unique letter count
+	//Every game's frame is the same size, so reuse one if there is one.
+	if (spare.frameSize == 0)
+		spare.frameSize = size;
+	assert(size == spare.frameSize);
+	if (!spare.frames.empty())
+	{
+		void* frame = spare.frames.back();
+		spare.frames.pop_back();
+		return frame;
+	}
+	return ::operator new(size);
+}
 
-//PASSED, DON'T TOUCH
-void printPhrases(const Phrase PHRASE_ARRAY[], const int PHRASE_NUM)
+void GameTask::promise_type::operator delete(void* frame, size_t size)
 {
-	string strUse; //Holds the value for t/f in IS_USED
+	assert(size == spareFrames().frameSize);
+	spareFrames().frames.push_back(frame);
+}
 
-	//Display the header
-	cout << setw(3) << right << "#" << " " << setw(49) << left 
-        << "Phrase" << setw(5) << left << "State" << endl;
-	
-    //Display the guesses required, text, and whether or not it is used.
-	for (int index = 0; index < PHRASE_NUM; index++)
-	{
-		if (PHRASE_ARRAY[index].isUsed)
-			strUse = "used";
-		else 
-			strUse = "unused";
+FramePool::~FramePool()
+{
+	for (void* frame : frames)
+		::operator delete(frame, frameSize);
+}
 
-		cout << setw(3) << right << PHRASE_ARRAY[index].guessesRequired << " " 
-			<< setw(49) << left << PHRASE_ARRAY[index].text 
-			<< setw(4) << strUse << endl;
-	}
+GuessResult resumeGame(GameTask& task, const char GUESS)
+{
+	task.handle.promise().guess = GUESS;
+	task.handle.resume();
+	return task.handle.promise().result;
 }
 
-//PASSED, DON'T TOUCH
-void sortPhrases(Phrase phraseArray[], const int PHRASE_NUM)
+bool taskDone(const GameTask& TASK)
 {
-	//Hold the location of the smallest number
-	int smallestIndex, iter;
+	return TASK.handle.done();
+}
 
-	for (int index = 0; index < PHRASE_NUM; index++)
-	{
-		smallestIndex = index;
+const Game& taskGame(const GameTask& TASK)
+{
+	return TASK.handle.promise().game;
+}
 
-		//If the iteration value is less than the index, swap the values.
-		for (iter = index + 1; iter < PHRASE_NUM; iter++)
-			if (phraseArray[iter].guessesRequired < 
-				phraseArray[smallestIndex].guessesRequired)
-				smallestIndex = iter;
+FramePool& spareFrames()
+{
+	//Frames are only ever for playGameTask, so they all have one size.
+	thread_local FramePool spare;
+	return spare;
+}
+#endif
 
-		//Swap the values in the outer loop 		
-		swapPhrases(index, smallestIndex, phraseArray);
-	}
+#ifndef __linux__
+void runServer(const Corpus&, const string, const string, const int, const unsigned int)
+{
+	cout << "The server is only available on Linux." << endl;
 }
 
-//WORKING, DON'T TOUCH
-void swapPhrases(const int INDEX, const int SMALL_INDEX, Phrase phraseArray[])
+void runLoadGenerator(const string, const int, const int, const int, const unsigned int,
+	const int)
+{
+	cout << "The load generator is only available on Linux." << endl;
+}
+#else
+void runServer(const Corpus& CORPUS, const string TEXT_FILE, 
+	const string COMPILED_FILE, const int PORT, const unsigned int THREADS)
 {
-    Phrase holdGuess;
+	vector<thread> threads;
+	CorpusFeed feed;
+	SessionTable table;
+
+	//Every shard gets all the room it can use now, so it never rehashes
+	//while games come and go.
+	table.shards = vector<SessionShard>(SESSION_SHARDS);
+	for (SessionShard& shard : table.shards)
+		shard.games.reserve(SESSION_LIMIT / SESSION_SHARDS);
 
-    //Takes the current index (smaller number) and moves it to holdGuess.
-	//Makes the index (smaller number) into the greater number (iter)
-    //Replaces iter with the index value (smaller number)
-    holdGuess = phraseArray[INDEX];
-	phraseArray[INDEX] = phraseArray[SMALL_INDEX];
-	phraseArray[SMALL_INDEX] = holdGuess;
+	//The first corpus belongs to main, so it is never freed from here.
+	feed.current = shared_ptr<const Corpus>(&CORPUS, [](const Corpus*) {});
+
+	raiseFileLimit();
+	cout << "Serving on port " << PORT << " with " << THREADS << " threads" << endl;
+
+	//Every thread runs its own event loop until the server is stopped.
+	thread watcher(watchCorpus, ref(feed), TEXT_FILE, COMPILED_FILE);
+	for (unsigned int worker = 0; worker < THREADS; worker++)
+		threads.emplace_back(serverLoop, cref(feed), ref(table), PORT, worker, THREADS);
+	for (unsigned int worker = 0; worker < THREADS; worker++)
+		threads[worker].join();
+	watcher.join();
 }
 
-//PASSED, DON'T TOUCH
-string phraseWithBlanks(const string CURRENT_PHRASE, const string CORRECT_GUESSES)
+void watchCorpus(CorpusFeed& feed, const string TEXT_FILE, const string COMPILED_FILE)
 {
-	//character to build the actual phrase
-	char buildPhrase;
+	const int SETTLE_MS = 100; //Quiet time after a change before loading
+	const int REAP_MS = 1000; //How often old corpora are checked
+	vector<shared_ptr<const Corpus>> retired; //Replaced, maybe still in use
+	alignas(inotify_event) char buffer[4096];
 
-	//string to hold the final product.
-	string holdPhrase = "";
+	//Loading runs at the lowest priority so it only takes spare time
+	//from the event loops. On Linux this only changes this thread.
+	setpriority(PRIO_PROCESS, 0, 19);
 
-	//bool to know what function to call.
-	bool noLength = false;
+	//Watch the directories so files replaced by a rename are seen too.
+	const int NOTIFY = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (NOTIFY < 0)
+	{
+		cout << "Can't watch the phrase files, reloading is off" << endl;
+		return;
+	}
+	const string NAMES[2] = {filesystem::path(TEXT_FILE).filename().string(),
+		filesystem::path(COMPILED_FILE).filename().string()};
+	for (const string& FILE_NAME : {TEXT_FILE, COMPILED_FILE})
+	{
+		const string DIRECTORY = filesystem::path(FILE_NAME).parent_path().string();
+		inotify_add_watch(NOTIFY, DIRECTORY.empty() ? "." : DIRECTORY.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO);
+	}
 
-	//If there is no guess value make no length true.
-	if (CORRECT_GUESSES.length() == 0)
-		noLength = true;
+	pollfd waiting = {NOTIFY, POLLIN, 0};
+	while (true)
+	{
+		//Free corpora nobody but this list holds any more.
+		retired.erase(remove_if(retired.begin(), retired.end(),
+			[](const shared_ptr<const Corpus>& OLD) { return OLD.use_count() == 1; }),
+			retired.end());
 
-	//at every character in holdphrase, loop through every character held in
-	//the guessed characters to determine how to display the output.
-	for (unsigned int index = 0; index < CURRENT_PHRASE.length(); index++)
-	{//Begin outer for loop
-		//What to do if the guesses have length.
-		if (!noLength)
+		if (poll(&waiting, 1, REAP_MS) <= 0)
+			continue;
+
+		//Let a burst of writes finish, then see if either file changed.
+		bool changed = false;
+		do
 		{
-			for (unsigned int iter = 0; iter < CORRECT_GUESSES.length(); iter++)
+			ssize_t bytes;
+			while ((bytes = read(NOTIFY, buffer, sizeof(buffer))) > 0)
 			{
-				buildPhrase = withGuesses(CURRENT_PHRASE[index], CORRECT_GUESSES[iter]);
-
-				//Break the loop if buildphrase is a character or punctuation.
-				if (buildPhrase != '_')
-					break;
+				for (ssize_t offset = 0; offset < bytes; )
+				{
+					const inotify_event* const EVENT = 
+						reinterpret_cast<const inotify_event*>(buffer + offset);
+					if (EVENT->len > 0 && (EVENT->name == NAMES[0] || EVENT->name == NAMES[1]))
+						changed = true;
+					offset += sizeof(inotify_event) + EVENT->len;
+				}
 			}
-		}
+		} while (changed && poll(&waiting, 1, SETTLE_MS) > 0);
+		if (!changed)
+			continue;
 
-		//there is no length to the correct guesses.
-		else
+		//Build the new corpus off to the side, the old one keeps serving.
+		shared_ptr<Corpus> fresh = make_shared<Corpus>();
+		if (loadCorpus(pickCorpusFile(TEXT_FILE, COMPILED_FILE), *fresh, true, 
+			TEXT_FILE) == 0)
 		{
-			buildPhrase = withoutGuesses(CURRENT_PHRASE[index]);
+			cout << "Reload failed, still serving the old phrases" << endl;
+			continue;
 		}
-		
-		//Use buildPhrase to create the whole phrase in holdPhrase.
-		holdPhrase += buildPhrase;
-		if (index + 1 != CURRENT_PHRASE.length())
-			holdPhrase += ' ';
-	}//End outer loop
 
-	return holdPhrase;
+		//Publish it, then hold the old one until its games are done.
+		retired.push_back(atomic_load_explicit(&feed.current, memory_order_acquire));
+		atomic_store_explicit(&feed.current, shared_ptr<const Corpus>(move(fresh)), 
+			memory_order_release);
+		feed.version.fetch_add(1, memory_order_release);
+		cout << "Reloaded " << atomic_load(&feed.current)->phraseNum << " phrases" << endl;
+	}
 }
 
-//WORKING, DON'T TOUCH
-char withGuesses(char currentVal, char guessVal)
+void serverLoop(const CorpusFeed& FEED, SessionTable& table, const int PORT, 
+	const unsigned int WORKER, const unsigned int THREADS)
 {
-	//Character to build the whole phrase
-	char buildPhrase;
+	const int MAX_EVENTS = 256; //Events handled per wait
+	const int IDLE_MS = 1000; //Longest wait, so an idle thread lets go of old corpora
+	const int REPLAY_MS = static_cast<int>(REPLAY_WAIT.count()); //Wait with records held
+	const int MAX_READS = 16; //Reads from one socket per wakeup, so nobody hogs the thread
+	const size_t MAX_LINE = 1024; //Longest request before the connection is dropped
+	const size_t OUT_HIGH = 1 << 16; //Replies waiting before a player's reads stop
+	epoll_event events[MAX_EVENTS];
+	unordered_map<int, ServerSession> sessions; //This thread's players, by socket
+	Random rng = seedRandom(static_cast<uint64_t>(time(nullptr)), WORKER);
+	char buffer[4096];
+	uint64_t version = FEED.version.load(memory_order_acquire); //Version of latest
+	shared_ptr<const Corpus> latest = atomic_load_explicit(&FEED.current, 
+		memory_order_acquire); //Where new games come from
+	auto swept = chrono::steady_clock::now(); //When this thread last dropped old games
+	int wait = IDLE_MS; //How long the next epoll_wait may block
 
-	//If the character in the actual phrase is equal to the upper or lowercase
-	//value of the character in correct guess. break loop if true because
-	//character should be placed into the variable and no longer tested.
-	if (currentVal == guessVal || 
-		currentVal == guessVal - 32 ||
-		currentVal == guessVal + 32)
-	{
-		buildPhrase = currentVal;
-	}
-	//If the character in the current phrase is any punctuation or space,
-	//put it into the phrase with blanks and break the loop because it should
-	//no longer be tested.
-	else if ((currentVal >= 32 && currentVal <= 64) || 
-		(currentVal >= 91 && currentVal <= 96))
+	const int LISTENER = openListener(PORT);
+	const int EPOLL = epoll_create1(0);
+	if (LISTENER < 0 || EPOLL < 0)
 	{
-		buildPhrase = currentVal;
+		cout << "Could not listen on port " << PORT << endl;
+		return;
 	}
-	//Put the character in the current phrase as an underscore until all 
-	//possibilities of guesses are tested.
-	else
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = LISTENER;
+	epoll_ctl(EPOLL, EPOLL_CTL_ADD, LISTENER, &event);
+
+	while (true)
 	{
-		buildPhrase = '_';
-	}
-	return buildPhrase;
-}
+		const int READY = epoll_wait(EPOLL, events, MAX_EVENTS, wait);
 
-//WORKING, DON'T TOUCH
-char withoutGuesses(char currentVal)
-{
-	//Returns the value to the entire string with blanks.
-	char buildPhrase;
+		//Pick up a reloaded corpus, it is only read again when it changes.
+		if (FEED.version.load(memory_order_acquire) != version)
+		{
+			version = FEED.version.load(memory_order_acquire);
+			latest = atomic_load_explicit(&FEED.current, memory_order_acquire);
+		}
 
-	//If the current index value is punctuation or a space,
-	//display it.
-	if ((currentVal >= 32 && currentVal <= 64) || 
-			(currentVal >= 91 && currentVal <= 96))
-		buildPhrase = currentVal;
-	
-	//Anything that isn't a space or punctuation, make an underscore.
-	else
-		buildPhrase = '_';
+		//Each thread keeps its own share of the shards free of idle games.
+		const auto NOW = chrono::steady_clock::now();
+		if (NOW - swept >= SESSION_SWEEP)
+		{
+			evictSessions(table, WORKER, THREADS, NOW);
+			swept = NOW;
+		}
 
-	return buildPhrase;
-}
+		for (int index = 0; index < READY; index++)
+		{
+			const int FD = events[index].data.fd;
 
-//PASSED, DON'T TOUCH
-DifficultyLevel getDifficultyLevel()
-{
-	//Holds difficulty level
-	int diff;
-	DifficultyLevel val;
+			//Take every waiting connection.
+			if (FD == LISTENER)
+			{
+				int client;
+				while ((client = accept4(LISTENER, nullptr, nullptr, SOCK_NONBLOCK)) >= 0)
+				{
+					const int ON = 1;
+					setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &ON, sizeof(ON));
+					event.events = EPOLLIN;
+					event.data.fd = client;
+					epoll_ctl(EPOLL, EPOLL_CTL_ADD, client, &event);
+					sessions[client].events = EPOLLIN;
+				}
+				continue;
+			}
 
-	//Display banner
-	cout << "Difficulty levels:" << endl;
-	cout << setw(5) << right << "1" << "  Easy" << endl; 
-	cout << setw(5) << right << "2" << "  Medium" << endl;
-	cout << setw(5) << right << "3" << "  Hard" << endl;
+			ServerSession& session = sessions[FD];
+			bool open = (events[index].events & (EPOLLERR | EPOLLHUP)) == 0;
 
-	//Get difficulty
-	cout << "Pick a difficulty level (1 to 3): ";
-	cin >> diff;
-	cin.clear();
-	cin.ignore(256, '\n');
-	cout << endl;
+			//Read a few buffers at most, anything left is still there on
+			//the next wakeup once the other players have had their turn.
+			if (open && (events[index].events & EPOLLIN))
+			{
+				ssize_t bytes = 0;
+				for (int reads = 0; reads < MAX_READS && 
+					(bytes = read(FD, buffer, sizeof(buffer))) > 0; reads++)
+					session.in.append(buffer, static_cast<size_t>(bytes));
+				if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+					open = false;
+			}
 
-	//Only occurs if the user inputs a number outside of 1-3
-	while (diff < 1 || diff > 3)
-	{
-		cout << "Please choose a difficulty level between 1 and 3: ";
-		cin >> diff;
-		cin.clear();
-		cin.ignore(256, '\n');
-		cout << endl;
-	}
+			//Answer full lines and send the replies. Once OUT_HIGH bytes
+			//are waiting the rest of the lines wait for the player to read.
+			while (true)
+			{
+				size_t start = 0, newline;
+				while (session.out.size() < OUT_HIGH && 
+					(newline = session.in.find('\n', start)) != string::npos)
+				{
+					size_t end = newline;
+					if (end > start && session.in[end - 1] == '\r')
+						end--;
+					handleRequest(session, session.in.substr(start, end - start),
+						latest, table, rng);
+					start = newline + 1;
+				}
+				session.in.erase(0, start);
+				if (open)
+					open = flushOutput(FD, session.out);
+				if (!open || session.out.size() >= OUT_HIGH || 
+					session.in.find('\n') == string::npos)
+					break;
+			}
 
-	//convert the diff to corresponding enum value after subtracting 1.
-	switch (--diff)
-	{
-		case 0:
-			val = EASY;
-			break;
-		case 1:
-			val = MEDIUM;
-			break;
-		case 2:
-			val = HARD;
-			break;
-		default:
-			val = INVALID_DIFFICULTY;
+			//A request is never this long, so it isn't a player.
+			if (session.in.size() > MAX_LINE && session.in.find('\n') == string::npos)
+				open = false;
 
-	}
-	return val;
-}
+			//Stop reading while the player isn't reading the replies, and
+			//only wait to write if they didn't all fit.
+			const uint32_t WANT = (session.out.size() < OUT_HIGH ? uint32_t(EPOLLIN) : 0) | 
+				(session.out.empty() ? 0 : uint32_t(EPOLLOUT));
+			if (open && WANT != session.events)
+			{
+				event.events = WANT;
+				event.data.fd = FD;
+				epoll_ctl(EPOLL, EPOLL_CTL_MOD, FD, &event);
+				session.events = WANT;
+			}
 
-//PROBABLY WORKING, DON'T TOUCH
-string convertDifficulty(DifficultyLevel diff)
-{
-	string level;
+			//Forget the player once the connection is gone. Their game
+			//stays in the table so they can resume it.
+			if (!open)
+			{
+				epoll_ctl(EPOLL, EPOLL_CTL_DEL, FD, nullptr);
+				close(FD);
+				sessions.erase(FD);
+			}
+		}
 
-	switch (diff)
-	{
-		case EASY:
-			level = "Easy";
-			break;
-		case MEDIUM:
-			level = "Medium";
-			break;
-		case HARD:
-			level = "Hard";
-			break;
-		default:
-			level = "Invalid";
+		//Finished games are logged within REPLAY_WAIT even if no more
+		//come in, so wake up sooner while any are held.
+		wait = flushStaleReplay(chrono::steady_clock::now()) ? REPLAY_MS : IDLE_MS;
 	}
-	return level;
 }
 
-//PASSED, DON'T TOUCH
-int randomPhraseIndex(int diff, const Phrase PHRASE_ARRAY[], int phraseNum)
+int openListener(const int PORT)
 {
-	//Random number variable that is also the return value for the index.
-	int randi = -1;
+	const int ON = 1;
+	sockaddr_in address = {};
+	const int FD = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
 
-	//variable to make sure that ever index gets used if division rounds down.
-	int leftover = phraseNum % 3;
+	if (FD < 0)
+		return -1;
 
-	//counter as a break for the do while loop in case ever variable has been used.
-	int counter = 0;
+	//Let every thread listen on the same port.
+	setsockopt(FD, SOL_SOCKET, SO_REUSEADDR, &ON, sizeof(ON));
+	setsockopt(FD, SOL_SOCKET, SO_REUSEPORT, &ON, sizeof(ON));
 
-	//Get the random number based on the difficulty.
-	do
-	{
-		switch (diff)
-		{
-			case 0:
-				randi = rand() % (phraseNum / 3);
-				break;
-			case 1:
-				randi = rand() % (phraseNum / 3) + (phraseNum / 3);
-				break;
-
-			//Add in the leftover guesses to the hardest difficulty
-			case 2:
-				randi = rand() % ((phraseNum / 3) + leftover) + (phraseNum / 3 * 2);
-				break;
-			default:
-				cout << convertDifficulty(static_cast<DifficultyLevel>(diff));
-		}
-		counter++;
-	} while (PHRASE_ARRAY[randi].isUsed && counter < 100);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(static_cast<uint16_t>(PORT));
 
-	if (counter == 100)
+	if (bind(FD, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+		listen(FD, SOMAXCONN) < 0)
 	{
-		cout << "Every phrase has been used." << endl;
+		close(FD);
+		return -1;
 	}
-	return randi;
+	return FD;
 }
 
-void runGame(Phrase singlePhrase)
+bool flushOutput(const int FD, string& out)
 {
-	//Struct to track the guesses and intitialized
-	//Index 0 is correct, index 1 is wrong, index 2 holds all
-	Guesses guess[3];
-	for (int index = 0; index < 3; index++)
+	size_t sent = 0;
+
+	while (sent < out.length())
 	{
-		guess[index].charGuesses = "";
-		guess[index].numOfGuesses = 0;
+		const ssize_t BYTES = write(FD, out.data() + sent, out.length() - sent);
+		if (BYTES < 0)
+		{
+			//The socket is full, the rest goes when it has room.
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return false;
+		}
+		sent += static_cast<size_t>(BYTES);
 	}
 
-	//Char guess from the user.
-	char currentGuess;
-
-	//Stores the blank phrase to be shown to the user
-	string blankPhrase;
-
-	do
-	{//Begin do...while loop
-		//Draw the gallows based on the number of incorrect guesses.
-		drawGallows(guess[1].numOfGuesses);
-
-		//Get and output the blank phrase
-		blankPhrase = phraseWithBlanks(singlePhrase.text, guess[0].charGuesses);
-		cout << blankPhrase << endl;
-		cout << "Previous incorrect guesses: " << guess[1].charGuesses << endl;
+	out.erase(0, sent);
+	return true;
+}
 
-		//Find the user's character guess
-		cout << "Enter guess: ";
-		cin >> currentGuess;
-		cin.clear();
-		cin.ignore(256, '\n');
-		cout << endl;
+void runLoadGenerator(const string HOST, const int PORT, const int LOAD_SESSIONS,
+	const int GAMES, const unsigned int THREADS, const int THINK_MS)
+{
+	const unsigned int WORKERS = max(THREADS, 1u);
+	vector<vector<uint32_t>> latencies(WORKERS); //Nanoseconds per request
+	vector<thread> threads;
+	vector<uint32_t> all;
 
-		//convert to lowercase if needed.
-		currentGuess = toLower(currentGuess);
+	raiseFileLimit();
 
-		//Clear the screen
-		for (int index = 0; index < 19; index++)
-			cout << endl;
+	//Split the sessions between the threads.
+	const auto START = chrono::steady_clock::now();
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+	{
+		const int SHARE = LOAD_SESSIONS / static_cast<int>(WORKERS) + 
+			(static_cast<int>(worker) < LOAD_SESSIONS % static_cast<int>(WORKERS));
+		threads.emplace_back(loadLoop, HOST, PORT, SHARE, GAMES, THINK_MS, worker,
+			ref(latencies[worker]));
+	}
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+		threads[worker].join();
+	const double SECONDS = chrono::duration<double>(
+		chrono::steady_clock::now() - START).count();
 
-		//Check the guess
-		checkGuess(currentGuess, singlePhrase.text, guess);
-		//Check for victory
+	for (unsigned int worker = 0; worker < WORKERS; worker++)
+		all.insert(all.end(), latencies[worker].begin(), latencies[worker].end());
+	if (all.empty())
+	{
+		cout << "No requests were answered." << endl;
+		return;
+	}
 
-	} while (!checkVictory(phraseWithBlanks(singlePhrase.text, guess[0].charGuesses)) && guess[1].numOfGuesses < 5); 
-	/*end do...while loop*/ 
+	//Find the percentiles.
+	sort(all.begin(), all.end());
+	auto percentile = [&all](const double FRACTION)
+	{ return all[min(all.size() - 1, static_cast<size_t>(FRACTION * all.size()))] / 1000.0; };
 
-	//Show the results and get the final phrase with blanks
-	blankPhrase = phraseWithBlanks(singlePhrase.text, guess[0].charGuesses);
-	displayResult(guess[1].numOfGuesses, singlePhrase.text, blankPhrase);	
+	cout << fixed << setprecision(1);
+	cout << "Sessions:             " << LOAD_SESSIONS << endl;
+	cout << "Requests:             " << all.size() << endl;
+	cout << "Requests per second:  " << all.size() / SECONDS << endl;
+	cout << "Latency p50:          " << percentile(0.50) << " us" << endl;
+	cout << "Latency p99:          " << percentile(0.99) << " us" << endl;
+	cout << "Latency p99.9:        " << percentile(0.999) << " us" << endl;
+	cout << "Latency max:          " << all.back() / 1000.0 << " us" << endl;
+	cout.unsetf(ios::floatfield);
 }
 
-void displayResult(int wrongGuesses, 
-	const string PHRASE, const string BLANK_PHRASE)
+void loadLoop(const string HOST, const int PORT, const int LOAD_SESSIONS,
+	const int GAMES, const int THINK_MS, const unsigned int WORKER,
+	vector<uint32_t>& latencies)
 {
-	//Show the gallows one last time
-	drawGallows(wrongGuesses);
-
-	//Display the blank phrase onelast time
-	cout << BLANK_PHRASE << endl;
+	typedef chrono::steady_clock::time_point TimePoint;
+	typedef pair<TimePoint, size_t> Wakeup;
 
-	//If they guessed 5 incorrectly
-	if (wrongGuesses == 5)
-		cout << "You're Dead! The phrase was:" << endl << "\"" <<
-			phraseWithBlanks(PHRASE, PHRASE) << "\"" << endl;
+	const int MAX_EVENTS = 256; //Events handled per wait
+	epoll_event events[MAX_EVENTS];
+	vector<LoadSession> sessions(static_cast<size_t>(max(LOAD_SESSIONS, 0)));
+	int active = 0; //Sessions that haven't finished their games
+	char buffer[4096];
 
-	//If they won
-	else 
-		cout << "You Win!" << endl;
-}
+	//Sessions waiting to send their next request, soonest first.
+	priority_queue<Wakeup, vector<Wakeup>, greater<Wakeup>> thinking;
+	Random rng = seedRandom(static_cast<uint64_t>(time(nullptr)), WORKER);
 
-//PROBABLY WORKING
-void checkGuess(const char USER_GUESS, const string SINGLE_PHRASE, 
-	Guesses guess[])
-{
-	//If the guess is not a letter
-	if ((USER_GUESS >= 32 && USER_GUESS <= 64) || 
-			(USER_GUESS >= 91 && USER_GUESS <= 96))
+	//Waits half to one and a half times the think time, so sessions
+	//don't all send at once.
+	auto think = [&](const size_t SESSION)
 	{
-		cout << "'" << USER_GUESS << "' is not a valid guess. Please enter a letter."
-			<< endl;
-		return;
-	}
+		const unsigned int MICROS = static_cast<unsigned int>(THINK_MS) * 1000;
+		thinking.push(Wakeup(chrono::steady_clock::now() + chrono::microseconds(
+			MICROS / 2 + randomBelow(rng, MICROS + 1)), SESSION));
+	};
 
-	//If the guess has already been guessed.
-	for (unsigned int index = 0; index < guess[2].charGuesses.length(); index++)
+	const int EPOLL = epoll_create1(0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(PORT));
+	inet_pton(AF_INET, HOST.c_str(), &address.sin_addr);
+
+	//Connect every session, then switch it to non-blocking.
+	for (size_t index = 0; index < sessions.size(); index++)
 	{
-		if(USER_GUESS == guess[2].charGuesses[index] || USER_GUESS == guess[2].charGuesses[index] + 32 ||
-			USER_GUESS == guess[2].charGuesses[index] - 32)
+		LoadSession& session = sessions[index];
+		const int ON = 1;
+		session.fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (session.fd < 0 || connect(session.fd, 
+			reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
 		{
-			cout << "You have already guessed an '" << guess[2].charGuesses[index] << "'." << endl;
-			return;
-		}		
+			cout << "Could not connect session " << index << endl;
+			if (session.fd >= 0)
+				close(session.fd);
+			session.fd = -1;
+			continue;
+		}
+		setsockopt(session.fd, IPPROTO_TCP, TCP_NODELAY, &ON, sizeof(ON));
+		fcntl(session.fd, F_SETFL, fcntl(session.fd, F_GETFL) | O_NONBLOCK);
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.u64 = index;
+		epoll_ctl(EPOLL, EPOLL_CTL_ADD, session.fd, &event);
+
+		session.gamesLeft = GAMES - 1;
+		session.newGame = true;
+		if (THINK_MS > 0)
+			think(index);
+		else
+			sendLoadRequest(session, true);
+		active++;
 	}
 
-	//Go through ever letter in the phrase and check if it is equal to the guess
-	//if it is, increment the number of correct guesses and total guesses, and
-	//Add the guessed character to the total guesses string and the correct
-	//guesses string.  If it is not, increment and update the total and
-	//wrong guesses.
-	for (unsigned int index = 0; index < SINGLE_PHRASE.length(); index++)
+	while (active > 0)
 	{
-		if(USER_GUESS == SINGLE_PHRASE[index] || USER_GUESS == SINGLE_PHRASE[index] + 32 ||
-			USER_GUESS == SINGLE_PHRASE[index] - 32)
+		//Send for every session that is done thinking.
+		while (!thinking.empty() && thinking.top().first <= chrono::steady_clock::now())
 		{
-			cout << "Good guess!" << endl;
-			guess[2].charGuesses += USER_GUESS;
-			guess[2].numOfGuesses++;
-			guess[0].charGuesses += USER_GUESS;
-			guess[0].numOfGuesses++;
-			return;
+			LoadSession& session = sessions[thinking.top().second];
+			if (session.fd >= 0)
+				sendLoadRequest(session, session.newGame);
+			thinking.pop();
 		}
-		else if (index == SINGLE_PHRASE.length() - 1)
+
+		//Wait for replies, or until the next session is done thinking.
+		int timeout = -1;
+		if (!thinking.empty())
+			timeout = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(
+				thinking.top().first - chrono::steady_clock::now()).count()) + 1;
+		const int READY = epoll_wait(EPOLL, events, MAX_EVENTS, timeout);
+
+		for (int index = 0; index < READY; index++)
 		{
-			cout << "Sorry, bad guess." << endl;
-			guess[2].charGuesses += USER_GUESS;
-			guess[2].numOfGuesses++;
-			guess[1].charGuesses += USER_GUESS;
-			guess[1].numOfGuesses++;
+			LoadSession& session = sessions[events[index].data.u64];
+			ssize_t bytes;
+			bool open = true;
+
+			while ((bytes = read(session.fd, buffer, sizeof(buffer))) > 0)
+				session.in.append(buffer, static_cast<size_t>(bytes));
+			if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+				open = false;
+
+			//Every reply answers the one request in flight.
+			size_t newline;
+			while (open && (newline = session.in.find('\n')) != string::npos)
+			{
+				const string REPLY = session.in.substr(0, newline);
+				session.in.erase(0, newline + 1);
+				latencies.push_back(static_cast<uint32_t>(min<long long>(UINT32_MAX,
+					chrono::duration_cast<chrono::nanoseconds>(
+					chrono::steady_clock::now() - session.sent).count())));
+
+				//Start the next game, stop, or keep guessing.
+				session.newGame = REPLY.compare(0, 3, "WON") == 0 || 
+					REPLY.compare(0, 4, "LOST") == 0;
+				if (REPLY.compare(0, 5, "ERROR") == 0 ||
+					(session.newGame && session.gamesLeft-- == 0))
+					open = false;
+				else if (THINK_MS > 0)
+					think(events[index].data.u64);
+				else
+					sendLoadRequest(session, session.newGame);
+			}
+
+			//The fd can be reused, so a wakeup still queued for this
+			//session has to see that it is gone.
+			if (!open)
+			{
+				epoll_ctl(EPOLL, EPOLL_CTL_DEL, session.fd, nullptr);
+				close(session.fd);
+				session.fd = -1;
+				active--;
+			}
 		}
 	}
+	close(EPOLL);
 }
 
-char toLower(char uGuess)
+void sendLoadRequest(LoadSession& session, const bool NEW_GAME)
 {
-	if (uGuess >= 65 && uGuess <= 90)
-		uGuess += 32;
+	const string GUESS_ORDER = "etaoinshrdlucmfwypvbgkjqxz";
+	string request;
+
+	//New games rotate through the difficulties, guesses go in frequency order.
+	if (NEW_GAME)
+	{
+		request = "new " + to_string(1 + session.gamesLeft % 3) + '\n';
+		session.nextLetter = 0;
+	}
+	else
+	{
+		request = GUESS_ORDER[session.nextLetter % GUESS_ORDER.length()];
+		request += '\n';
+		session.nextLetter++;
+	}
 
-	return uGuess;
+	//Requests are tiny, so they always fit in the socket.
+	session.sent = chrono::steady_clock::now();
+	flushOutput(session.fd, request);
 }
 
-bool checkVictory(string guessedPhrase){
-	for (int i = 0; i < guessedPhrase.length(); i++)
-		if (guessedPhrase[i] == '_')
-			return false;
-	return true;
-}
\ No newline at end of file
+void raiseFileLimit()
+{
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+#endif